@@ -16,6 +16,34 @@ static uint32_t crc32_naive_u8(uint8_t in)
     return crc;
 }
 
+/* a * b mod P, bit-reflected, 0x80000000 is x^0 */
+static uint32_t multmodp(uint32_t a, uint32_t b)
+{
+    const uint32_t p = 0x82F63B78;
+    uint32_t m = 1U << 31, r = 0;
+
+    while (m) {
+        if (a & m)
+            r ^= b;
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ p : b >> 1;
+    }
+
+    return r;
+}
+
+/* CRC32(0, vmull_p32(a, b)), i.e. a * b * x^33 mod P */
+static uint32_t mulmod33(uint32_t a, uint32_t b)
+{
+    const uint32_t p = 0x82F63B78;
+    uint32_t r = multmodp(a, b);
+
+    for (int i = 0; i < 33; i++)
+        r = (r & 1) ? (r >> 1) ^ p : r >> 1;
+
+    return r;
+}
+
 int main(void)
 {
     uint32_t crc[4][256];
@@ -44,5 +72,44 @@ int main(void)
 
     printf("\n};\n");
 
+    /*
+     * Nibble tables for crc32_nib, 512 bytes in total.
+     * crc[3-k][b] = crc[3-k][b & 0xF] ^ crc[3-k][b & 0xF0]
+     */
+    printf("\nstatic const uint32_t crc32_nib_tbl[8][16] = {\n");
+    for (int i = 0; i < 8; ++i) {
+        printf("    {\n");
+        for (int j = 0; j < 16; ++j) {
+            const uint32_t v = crc[3-i/2][(i & 1) ? j << 4 : j];
+            printf("%s0x%08X,%s", j%4?" ":"        ", v, j%4==3?"\n":"");
+        }
+        printf("    },\n");
+    }
+    printf("};\n");
+
+    /* CRC32 (IEEE), zlib polynomial, for crc32_dual */
+    uint32_t ieee[256];
+
+    for (int i = 0; i < 256; ++i) {
+        ieee[i] = i;
+        for (int k = 0; k < 8; k++)
+            ieee[i] = (ieee[i] & 1) ? (ieee[i] >> 1) ^ 0xEDB88320 : ieee[i] >> 1;
+    }
+
+    printf("\nstatic const uint32_t crc32_ieee_tbl[256] = {\n");
+    for (int i = 0; i < 256; ++i)
+        printf("%s0x%08X,%s", i%4?" ":"    ", ieee[i], i%4==3?"\n":"");
+    printf("};\n");
+
+    /* x^(64*2^k-32-1) mod P, for crc32c_zeros */
+    uint32_t z = 1;     /* x^31 */
+
+    printf("\nstatic const uint32_t crc32c_zeros_tbl[64] = {\n");
+    for (int k = 0; k < 64; ++k) {
+        printf("%s0x%08X,%s", k%4?" ":"    ", z, k%4==3?"\n":"");
+        z = mulmod33(z, z);
+    }
+    printf("};\n");
+
     return 0;
 }
@@ -2,7 +2,7 @@
 #include <stdint.h>
 #include <assert.h>
 
-const uint32_t P = 0x82F63B78;
+uint32_t P = 0x82F63B78;     /* CRC32C, or CRC32 (IEEE) below */
 
 /* x^n mod P */
 static uint32_t poly(int n)
@@ -33,9 +33,31 @@ int main(void)
 {
     poly(42*64-32-1);
     poly(42*64*2-32-1);
+    poly(256*8-32-1);
+    poly(256*8*2-32-1);
+    poly(24*64-32-1);
+    poly(24*64*2-32-1);
+    poly(128*64-32-1);
+    poly(128*64*2-32-1);
+    poly(21*64-32-1);
+    poly(21*64*2-32-1);
+    poly(170*64-32-1);
+    poly(170*64*2-32-1);
+    poly(2730*64-32-1);
+    poly(2730*64*2-32-1);
     poly(96+128-32-1);
     poly(64+128-32-1);
     poly(128-32-1);
 
+    /* crc32_dual fold constants, x^(n-32) for n = 8*shift+64-1, 8*shift-1 */
+    P = 0xEDB88320;
+    printf("IEEE\n");
+    poly(16*8+64-1-32);
+    poly(16*8-1-32);
+    poly(256*8+64-1-32);
+    poly(256*8-1-32);
+    poly(256*8*2+64-1-32);
+    poly(256*8*2-1-32);
+
     return 0;
 }
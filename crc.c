@@ -1,6 +1,9 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <inttypes.h>
 #include <sys/time.h>
+#include <time.h>
 #include <assert.h>
 
 #include "crctbl.c"
@@ -60,8 +63,211 @@ static uint64_t vmull_p32(uint32_t p1, uint32_t p2)
 #include <zlib.h>
 #endif
 
+/* serialized cycle counter, rdtscp on x86, virtual counter on arm64 */
+static inline uint64_t tick(void)
+{
+#if defined(__x86_64__)
+    unsigned int aux;
+    _mm_lfence();
+    uint64_t t = __rdtscp(&aux);
+    _mm_lfence();
+    return t;
+#elif defined(__aarch64__)
+    uint64_t t;
+    __asm__ volatile("isb; mrs %0, cntvct_el0; isb" : "=r"(t) :: "memory");
+    return t;
+#endif
+}
+
+/* ns per tick, calibrated against CLOCK_MONOTONIC */
+static double tick_ns(void)
+{
+    struct timespec ts1, ts2;
+    uint64_t t1, t2;
+    double ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts1);
+    t1 = tick();
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &ts2);
+        ns = (ts2.tv_sec - ts1.tv_sec) * 1e9 + (ts2.tv_nsec - ts1.tv_nsec);
+    } while (ns < 100e6);
+    t2 = tick();
+
+    return ns / (t2 - t1);
+}
+
+/*
+ * Hot path telemetry, compiled in with CRC32_TELEMETRY, compiled out to
+ * nothing otherwise. Counters are per thread, each engine's block padded to
+ * its own cache lines, so updates never contend. Nested calls (e.g. the
+ * tail of crc32_lut4 through crc32_lut) count for both engines.
+ */
+enum {
+    CRC32_TM_HW,
+    CRC32_TM_HW_PF,
+    CRC32_TM_HW_X3,
+    CRC32_TM_FIXED,
+    CRC32_TM_FOLD,
+    CRC32_TM_LUT,
+    CRC32_TM_LUT4,
+    CRC32_TM_NIB,
+    CRC32_TM_PSHUFB,
+    CRC32_TM_CRC64_LUT8,
+    CRC32_TM_CRC64_FOLD,
+    CRC32_TM_DUAL,
+    CRC32_TM_MAX,
+};
+
+#ifdef CRC32_TELEMETRY
+#include <pthread.h>
+
+static const char *crc32_tm_name[CRC32_TM_MAX] = {
+    "crc32_hw", "crc32_hw_pf", "crc32_hw_x3", "crc32c_fixed", "crc32_fold",
+    "crc32_lut", "crc32_lut4", "crc32_nib", "crc32_pshufb",
+    "crc64_lut8", "crc64_fold", "crc32_dual",
+};
+
+struct crc32_tm_engine {
+    uint64_t calls;
+    uint64_t bytes;
+    uint64_t hist[64];      /* hist[k]: size in [2^(k-1), 2^k) */
+} __attribute__((aligned(64)));
+
+struct crc32_telemetry {
+    struct crc32_tm_engine engine[CRC32_TM_MAX];
+    uint64_t prologue_ticks;    /* crc32_hw alignment prologue */
+    uint64_t loop_ticks;        /* crc32_hw main loops and tail */
+    struct crc32_telemetry *next;
+} __attribute__((aligned(64)));
+
+static struct crc32_telemetry *crc32_tm_head;
+static pthread_mutex_t crc32_tm_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread struct crc32_telemetry *crc32_tm;
+
+/* owner thread is the only writer, relaxed atomics keep snapshots sane */
+#define CRC32_TM_INC(field, v) \
+    __atomic_store_n(&(field), (field) + (v), __ATOMIC_RELAXED)
+
+static struct crc32_telemetry *crc32_tm_get(void)
+{
+    if (!crc32_tm) {
+        struct crc32_telemetry *t = aligned_alloc(64, sizeof(*t));
+        memset(t, 0, sizeof(*t));
+        pthread_mutex_lock(&crc32_tm_lock);
+        t->next = crc32_tm_head;
+        crc32_tm_head = t;
+        pthread_mutex_unlock(&crc32_tm_lock);
+        crc32_tm = t;
+    }
+    return crc32_tm;
+}
+
+static inline void crc32_tm_call(int engine, size_t size)
+{
+    struct crc32_tm_engine *e = &crc32_tm_get()->engine[engine];
+    const int k = size ? 64 - __builtin_clzll(size) : 0;
+
+    CRC32_TM_INC(e->calls, 1);
+    CRC32_TM_INC(e->bytes, size);
+    CRC32_TM_INC(e->hist[k < 63 ? k : 63], 1);
+}
+
+/* unserialized counter, cheap enough for every call */
+static inline uint64_t crc32_tm_now(void)
+{
+#if defined(__x86_64__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t t;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(t));
+    return t;
+#endif
+}
+
+/* sum of all threads, including exited ones */
+static void crc32_telemetry_snapshot(struct crc32_telemetry *out)
+{
+    memset(out, 0, sizeof(*out));
+
+    pthread_mutex_lock(&crc32_tm_lock);
+    for (struct crc32_telemetry *t = crc32_tm_head; t; t = t->next) {
+        for (int i = 0; i < CRC32_TM_MAX; ++i) {
+            const struct crc32_tm_engine *e = &t->engine[i];
+            out->engine[i].calls += __atomic_load_n(&e->calls, __ATOMIC_RELAXED);
+            out->engine[i].bytes += __atomic_load_n(&e->bytes, __ATOMIC_RELAXED);
+            for (int k = 0; k < 64; ++k)
+                out->engine[i].hist[k] += __atomic_load_n(&e->hist[k], __ATOMIC_RELAXED);
+        }
+        out->prologue_ticks += __atomic_load_n(&t->prologue_ticks, __ATOMIC_RELAXED);
+        out->loop_ticks += __atomic_load_n(&t->loop_ticks, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&crc32_tm_lock);
+}
+
+/* text export, one "engine calls bytes" line plus "  [lo, hi) count" lines */
+static void crc32_telemetry_print(FILE *f, const struct crc32_telemetry *t)
+{
+    for (int i = 0; i < CRC32_TM_MAX; ++i) {
+        const struct crc32_tm_engine *e = &t->engine[i];
+
+        if (!e->calls)
+            continue;
+        fprintf(f, "%-14s calls %" PRIu64 " bytes %" PRIu64 "\n",
+                crc32_tm_name[i], e->calls, e->bytes);
+        for (int k = 0; k < 64; ++k) {
+            if (e->hist[k])
+                fprintf(f, "  [%" PRIu64 ", %" PRIu64 ") %" PRIu64 "\n",
+                        k ? 1ULL << (k-1) : 0, 1ULL << k, e->hist[k]);
+        }
+    }
+    fprintf(f, "crc32_hw ticks: prologue %" PRIu64 " loops %" PRIu64 "\n",
+            t->prologue_ticks, t->loop_ticks);
+}
+
+#define CRC32_TM_CALL(engine, size) crc32_tm_call(engine, size)
+#define CRC32_TM_START(t)           uint64_t t = crc32_tm_now()
+#define CRC32_TM_LAP(t, field)                                      \
+    do {                                                            \
+        uint64_t now_ = crc32_tm_now();                             \
+        CRC32_TM_INC(crc32_tm_get()->field, now_ - (t));            \
+        (t) = now_;                                                 \
+    } while (0)
+#else
+#define CRC32_TM_CALL(engine, size) do { } while (0)
+#define CRC32_TM_START(t)           do { } while (0)
+#define CRC32_TM_LAP(t, field)      do { } while (0)
+#endif
+
+/*
+ * CRC of lane*3 u64 words as three parallel streams, merged by
+ * k0 = x^(lane*64*2-32-1) mod P, k1 = x^(lane*64-32-1) mod P.
+ * Inlined with constant arguments so the merge constants and loop count
+ * are baked into the caller.
+ */
+static inline __attribute__((always_inline))
+uint32_t crc32_3way(const uint64_t *in64, const int lane, uint32_t crc,
+                    const uint32_t k0, const uint32_t k1)
+{
+    uint32_t crc0 = crc, crc1 = 0, crc2 = 0;
+
+    for (int i = 0; i < lane; i++, in64++) {
+        crc0 = crc32c_u64(crc0, *(in64));
+        crc1 = crc32c_u64(crc1, *(in64+lane));
+        crc2 = crc32c_u64(crc2, *(in64+lane*2));
+    }
+
+    crc0 = crc32c_u64(0, vmull_p32(crc0, k0));
+    crc1 = crc32c_u64(0, vmull_p32(crc1, k1));
+
+    return crc0 ^ crc1 ^ crc2;
+}
+
 static uint32_t crc32_hw(const uint8_t* in, size_t size, uint32_t crc)
 {
+    CRC32_TM_CALL(CRC32_TM_HW, size);
+    CRC32_TM_START(t);
+
     if (((uintptr_t)(in) & 1) && size >= 1) {
         crc = crc32c_u8(crc, *in);
         ++in;
@@ -78,29 +284,31 @@ static uint32_t crc32_hw(const uint8_t* in, size_t size, uint32_t crc)
         size -= 4;
     }
 
+    CRC32_TM_LAP(t, prologue_ticks);
+
 #ifdef CRC32_OPT
+    /*
+     * Tiered lane geometries, take the biggest tier that fits and drop down
+     * a tier for the remainder:
+     * - 3 x 128 u64, 3072 bytes
+     * - 3 x 42 u64 + 2 u64, 1024 bytes
+     * - 3 x 24 u64, 576 bytes
+     * Merge constants: x^(lane*64*2-32-1) mod P, x^(lane*64-32-1) mod P
+     */
     const uint64_t *in64 = (const uint64_t *)in;
+    while (size >= 3072) {
+        crc = crc32_3way(in64, 128, crc, 0xa51b6135, 0x170076fa);
+        in64 += 128*3;
+        size -= 3072;
+    }
     while (size >= 1024) {
-		uint32_t crc0 = crc, crc1 = 0, crc2 = 0;
-
         /*
          * crc0: in64[ 0,  1, ...,  41]
          * crc1: in64[42, 43, ...,  83]
          * crc2: in64[84, 85, ..., 125]
          */
-        for (int i = 0; i < 42; i++, in64++) {
-            crc0 = crc32c_u64(crc0, *(in64));
-            crc1 = crc32c_u64(crc1, *(in64+42));
-            crc2 = crc32c_u64(crc2, *(in64+42*2));
-        }
-        in64 += 42*2;
-
-        /* CRC32(crc0 * (x^(42*64*2-32) mod P)) */
-        crc0 = crc32c_u64(0, vmull_p32(crc0, 0xcec3662e));
-        /* CRC32(crc1 * (x^(42*64-32) mod P)) */
-        crc1 = crc32c_u64(0, vmull_p32(crc1, 0xa60ce07b));
-
-        crc = crc0 ^ crc1 ^ crc2;
+        crc = crc32_3way(in64, 42, crc, 0xcec3662e, 0xa60ce07b);
+        in64 += 42*3;
 
         /* last two u64 */
         crc = crc32c_u64(crc, *in64++);
@@ -108,6 +316,11 @@ static uint32_t crc32_hw(const uint8_t* in, size_t size, uint32_t crc)
 
         size -= 1024;
     }
+    if (size >= 576) {
+        crc = crc32_3way(in64, 24, crc, 0xd270f1a2, 0xab7aff2a);
+        in64 += 24*3;
+        size -= 576;
+    }
     in = (const uint8_t *)in64;
 #endif
 
@@ -130,13 +343,331 @@ static uint32_t crc32_hw(const uint8_t* in, size_t size, uint32_t crc)
         crc = crc32c_u8(crc, *in);
     }
 
+    CRC32_TM_LAP(t, loop_ticks);
+
     return crc;
 }
 
-static uint32_t crc32_naive_u8(uint8_t in)
+/*
+ * Prefetch distance in bytes for crc32_hw_pf. Streams larger than LLC are
+ * bound by DRAM latency, the hardware prefetcher alone can't keep three
+ * lanes 336 bytes apart fed. Tune with "crc-prefetch <dist>".
+ */
+#ifndef CRC32_PF_DIST
+#define CRC32_PF_DIST   4096
+#endif
+
+static size_t crc32_pf_dist = CRC32_PF_DIST;
+
+/*
+ * 3-way crc32_hw loop with software prefetch. Each 1024 bytes block covers
+ * all three lanes, so prefetching the block crc32_pf_dist ahead keeps every
+ * lane that far ahead. nta = 1 uses non-temporal hint (prefetchnta, PLDL1STRM)
+ * to avoid evicting hot working set when scanning cold data.
+ */
+static inline __attribute__((always_inline))
+uint32_t crc32_hw_pf_(const uint8_t *in, size_t size, uint32_t crc, const int nta)
+{
+    CRC32_TM_CALL(CRC32_TM_HW_PF, size);
+
+    /* align to 8 bytes */
+    size_t head = (-(uintptr_t)in) & 7;
+    if (head > size)
+        head = size;
+    crc = crc32_hw(in, head, crc);
+    in += head;
+    size -= head;
+
+    const uint64_t *in64 = (const uint64_t *)in;
+    while (size >= 1024) {
+        const uint8_t *pf = (const uint8_t *)in64 + crc32_pf_dist;
+        for (int i = 0; i < 1024; i += 64) {
+            if (nta)
+                __builtin_prefetch(pf + i, 0, 0);
+            else
+                __builtin_prefetch(pf + i, 0, 3);
+        }
+
+        crc = crc32_3way(in64, 42, crc, 0xcec3662e, 0xa60ce07b);
+        in64 += 42*3;
+
+        /* last two u64 */
+        crc = crc32c_u64(crc, *in64++);
+        crc = crc32c_u64(crc, *in64++);
+
+        size -= 1024;
+    }
+
+    return crc32_hw((const uint8_t *)in64, size, crc);
+}
+
+static uint32_t crc32_hw_pf(const uint8_t *in, size_t size, uint32_t crc)
+{
+    return crc32_hw_pf_(in, size, crc, 0);
+}
+
+static uint32_t crc32_hw_pf_nta(const uint8_t *in, size_t size, uint32_t crc)
+{
+    return crc32_hw_pf_(in, size, crc, 1);
+}
+
+/*
+ * Fixed size entry points for aligned sectors and pages. No alignment
+ * prologue, no size tests, no tails: lane split, merge constants and the
+ * trailing words are all compile time constants.
+ */
+#define CRC32C_FIXED(name, size, lane, k0, k1)                              \
+static uint32_t name(const void *aligned, uint32_t crc)                     \
+{                                                                           \
+    _Static_assert((size) % 8 == 0 && (lane) * 3 <= (size) / 8, #name);     \
+    const uint64_t *in64 = (const uint64_t *)aligned;                       \
+                                                                            \
+    CRC32_TM_CALL(CRC32_TM_FIXED, size);                                    \
+    crc = crc32_3way(in64, lane, crc, k0, k1);                              \
+    in64 += (lane) * 3;                                                     \
+                                                                            \
+    _Pragma("GCC unroll 8")                                                 \
+    for (int i = 0; i < (size) / 8 - (lane) * 3; i++)                       \
+        crc = crc32c_u64(crc, *in64++);                                     \
+                                                                            \
+    return crc;                                                             \
+}
+
+CRC32C_FIXED(crc32c_512, 512,   21,   0xa60ce07b, 0x1b3d8f29)
+CRC32C_FIXED(crc32c_4k,  4096,  170,  0x5aa1f3cf, 0x3f70cc6f)
+CRC32C_FIXED(crc32c_64k, 65536, 2730, 0x4e9e1255, 0x99ab0371)
+
+/*
+ * CRC extended by len zero bytes, O(log len).
+ * crc32c_u64(0, vmull_p32(a, b)) = a * b * x^33 mod P, so products of
+ * x^(n-33) terms stay in that form. crc32c_zeros_tbl[k] = x^(64*2^k-33).
+ */
+static uint32_t crc32c_zeros(uint32_t crc, uint64_t len)
+{
+    for (int i = 0; i < (len & 7); i++)
+        crc = crc32c_u8(crc, 0);
+    len >>= 3;
+
+    for (int k = 0; len; k++, len >>= 1) {
+        if (len & 1)
+            crc = crc32c_u64(0, vmull_p32(crc, crc32c_zeros_tbl[k]));
+    }
+
+    return crc;
+}
+
+/*
+ * Three independent buffers in parallel, e.g. a batch of small files too
+ * short for the 3-way lanes of crc32_hw. Interleaves u64 steps over the
+ * common length, then finishes each buffer on its own.
+ */
+static void crc32_hw_x3(const uint8_t *const in[3], const size_t size[3],
+                        uint32_t crc[3])
+{
+    CRC32_TM_CALL(CRC32_TM_HW_X3, size[0]);
+    CRC32_TM_CALL(CRC32_TM_HW_X3, size[1]);
+    CRC32_TM_CALL(CRC32_TM_HW_X3, size[2]);
+
+    size_t n = size[0] < size[1] ? size[0] : size[1];
+    n = (n < size[2] ? n : size[2]) / 8;
+
+    const uint64_t *in0 = (const uint64_t *)in[0];
+    const uint64_t *in1 = (const uint64_t *)in[1];
+    const uint64_t *in2 = (const uint64_t *)in[2];
+    uint32_t crc0 = crc[0], crc1 = crc[1], crc2 = crc[2];
+
+    for (size_t i = 0; i < n; i++) {
+        crc0 = crc32c_u64(crc0, in0[i]);
+        crc1 = crc32c_u64(crc1, in1[i]);
+        crc2 = crc32c_u64(crc2, in2[i]);
+    }
+
+    crc[0] = crc32_hw(in[0] + n*8, size[0] - n*8, crc0);
+    crc[1] = crc32_hw(in[1] + n*8, size[1] - n*8, crc1);
+    crc[2] = crc32_hw(in[2] + n*8, size[2] - n*8, crc2);
+}
+
+/*
+ * Streaming CRC32C for many tiny appends (headers, varints, short keys).
+ * Small appends are staged in an aligned buffer and flushed through the
+ * 3-way loop of crc32_hw 1K at a time; large appends are hashed in place.
+ * Result equals one crc32_hw call over the whole stream.
+ */
+#define CRC32C_CTX_BUF  1024
+
+struct crc32c_ctx {
+    uint8_t buf[CRC32C_CTX_BUF] __attribute__((aligned(64)));
+    size_t len;
+    uint32_t crc;
+};
+
+static void crc32c_init(struct crc32c_ctx *ctx, uint32_t crc)
+{
+    ctx->len = 0;
+    ctx->crc = crc;
+}
+
+static void crc32c_update(struct crc32c_ctx *ctx, const void *data, size_t size)
+{
+    const uint8_t *in = data;
+
+    if (ctx->len + size < CRC32C_CTX_BUF) {
+        memcpy(ctx->buf + ctx->len, in, size);
+        ctx->len += size;
+        return;
+    }
+
+    if (ctx->len) {
+        const size_t n = CRC32C_CTX_BUF - ctx->len;
+        memcpy(ctx->buf + ctx->len, in, n);
+        ctx->crc = crc32_hw(ctx->buf, CRC32C_CTX_BUF, ctx->crc);
+        ctx->len = 0;
+        in += n;
+        size -= n;
+    }
+
+    if (size >= CRC32C_CTX_BUF) {
+        ctx->crc = crc32_hw(in, size, ctx->crc);
+        return;
+    }
+
+    memcpy(ctx->buf, in, size);
+    ctx->len = size;
+}
+
+/* flushes staged bytes, ctx stays valid for more updates */
+static uint32_t crc32c_final(struct crc32c_ctx *ctx)
+{
+    ctx->crc = crc32_hw(ctx->buf, ctx->len, ctx->crc);
+    ctx->len = 0;
+
+    return ctx->crc;
+}
+
+/*
+ * CRC32C of a buffer that arrives out of order, e.g. network segments or
+ * parallel reads. Each chunk is hashed on arrival with init 0 and merged
+ * into adjacent intervals by shift-combine, CRC(A|B) = zeros(A, |B|) ^ B,
+ * so the full CRC is ready as soon as the last gap fills. Intervals are
+ * kept sorted and disjoint in an array, insert is O(outstanding gaps),
+ * which stays small for reordering windows. Overlapping chunks are
+ * rejected.
+ */
+/* crc32c_asm_add results */
+enum {
+    CRC32C_ASM_NOMEM = -2,  /* interval array could not grow */
+    CRC32C_ASM_BAD = -1,    /* overlap or out of range */
+    CRC32C_ASM_OK = 0,      /* accepted, gaps left */
+    CRC32C_ASM_DONE = 1,    /* buffer complete */
+};
+
+struct crc32c_asm_ival {
+    uint64_t off, len;
+    uint32_t crc;
+};
+
+struct crc32c_asm {
+    struct crc32c_asm_ival *ival;
+    size_t n, cap;
+    uint64_t total;
+    uint32_t init;
+};
+
+static int crc32c_asm_init(struct crc32c_asm *a, uint64_t total, uint32_t init)
+{
+    a->cap = 16;
+    a->ival = malloc(a->cap * sizeof(*a->ival));
+    if (!a->ival)
+        return -1;
+    a->n = 0;
+    a->total = total;
+    a->init = init;
+    return 0;
+}
+
+static void crc32c_asm_free(struct crc32c_asm *a)
+{
+    free(a->ival);
+    a->ival = NULL;
+}
+
+/* an empty buffer has no gaps */
+static int crc32c_asm_done(const struct crc32c_asm *a)
+{
+    return a->total == 0 || (a->n == 1 && a->ival[0].len == a->total);
+}
+
+static int crc32c_asm_add(struct crc32c_asm *a, uint64_t off,
+                          const void *data, size_t size)
+{
+    struct crc32c_asm_ival *iv = a->ival;
+    size_t lo = 0, hi = a->n;
+
+    if (off > a->total || size > a->total - off)
+        return CRC32C_ASM_BAD;
+    if (size == 0)
+        return crc32c_asm_done(a) ? CRC32C_ASM_DONE : CRC32C_ASM_OK;
+
+    /* first interval starting after off */
+    while (lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        if (iv[mid].off <= off)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo && iv[lo-1].off + iv[lo-1].len > off)
+        return CRC32C_ASM_BAD;
+    if (lo < a->n && off + size > iv[lo].off)
+        return CRC32C_ASM_BAD;
+
+    const uint32_t crc = crc32_hw(data, size, 0);
+    const int left = lo && iv[lo-1].off + iv[lo-1].len == off;
+    const int right = lo < a->n && off + size == iv[lo].off;
+
+    if (left && right) {
+        struct crc32c_asm_ival *l = &iv[lo-1];
+        l->crc = crc32c_zeros(l->crc, size) ^ crc;
+        l->crc = crc32c_zeros(l->crc, iv[lo].len) ^ iv[lo].crc;
+        l->len += size + iv[lo].len;
+        memmove(&iv[lo], &iv[lo+1], (a->n - lo - 1) * sizeof(*iv));
+        a->n--;
+    } else if (left) {
+        iv[lo-1].crc = crc32c_zeros(iv[lo-1].crc, size) ^ crc;
+        iv[lo-1].len += size;
+    } else if (right) {
+        iv[lo].crc = crc32c_zeros(crc, iv[lo].len) ^ iv[lo].crc;
+        iv[lo].off = off;
+        iv[lo].len += size;
+    } else {
+        if (a->n == a->cap) {
+            iv = realloc(iv, a->cap * 2 * sizeof(*iv));
+            if (!iv)
+                return CRC32C_ASM_NOMEM;
+            a->ival = iv;
+            a->cap *= 2;
+        }
+        memmove(&iv[lo+1], &iv[lo], (a->n - lo) * sizeof(*iv));
+        iv[lo].off = off;
+        iv[lo].len = size;
+        iv[lo].crc = crc;
+        a->n++;
+    }
+
+    return crc32c_asm_done(a) ? CRC32C_ASM_DONE : CRC32C_ASM_OK;
+}
+
+/* valid once complete: CRC32C_ASM_DONE returned, or total == 0 */
+static uint32_t crc32c_asm_final(const struct crc32c_asm *a)
+{
+    const uint32_t raw = a->total ? a->ival[0].crc : 0;
+
+    return crc32c_zeros(a->init, a->total) ^ raw;
+}
+
+static uint32_t crc32_naive_u8(uint8_t in, uint32_t p)
 {
     uint32_t crc = in;
-    const uint32_t p = 0x82F63B78;
 
     for (int i = 0; i < 8; i++) {
         int bit0 = crc & 1;
@@ -148,10 +679,12 @@ static uint32_t crc32_naive_u8(uint8_t in)
     return crc;
 }
 
-static uint32_t crc32_naive(const uint8_t *in, size_t size, uint32_t crc)
+/* any 32-bit reflected polynomial */
+static uint32_t crc32_naive_p(const uint8_t *in, size_t size, uint32_t crc,
+                              uint32_t p)
 {
     for (int i = 0; i < size; i++) {
-        uint32_t tmp = crc32_naive_u8(crc ^ in[i]);
+        uint32_t tmp = crc32_naive_u8(crc ^ in[i], p);
         crc >>= 8;
         crc ^= tmp;
     }
@@ -159,44 +692,567 @@ static uint32_t crc32_naive(const uint8_t *in, size_t size, uint32_t crc)
     return crc;
 }
 
+static uint32_t crc32_naive(const uint8_t *in, size_t size, uint32_t crc)
+{
+    return crc32_naive_p(in, size, crc, 0x82F63B78);
+}
+
 static uint32_t crc32_lut(const uint8_t *in, size_t size, uint32_t crc)
 {
+    CRC32_TM_CALL(CRC32_TM_LUT, size);
+
     for (int i = 0; i < size; i++) {
         uint32_t tmp = crc32_tbl[0][(crc ^ in[i]) & 0xFF];
         crc >>= 8;
         crc ^= tmp;
     }
 
-    return crc;
+    return crc;
+}
+
+static uint32_t crc32_lut4(const uint8_t *in, size_t size, uint32_t crc)
+{
+    CRC32_TM_CALL(CRC32_TM_LUT4, size);
+
+    const int unaligned = (uintptr_t)in & 3;
+    if (unaligned) {
+        int align = 4 - unaligned;
+        if (align > size)
+            align = size;
+        crc = crc32_lut(in, align, crc);
+        in += align;
+        size -= align;
+    }
+
+    const uint32_t *in32 = (const uint32_t *)in;
+    while (size >= 4) {
+        crc ^= *in32++;
+        crc = crc32_tbl[3][crc & 0xFF] ^
+              crc32_tbl[2][(crc >> 8) & 0xFF] ^
+              crc32_tbl[1][(crc >> 16) & 0xFF] ^
+              crc32_tbl[0][crc >> 24];
+        size -= 4;
+    }
+
+    return crc32_lut((const uint8_t *)in32, size, crc);
+}
+
+/*
+ * Compact table engine, 8 nibble tables of 16 entries, 512 bytes (8 cache
+ * lines) against 4K of crc32_lut4. Slower when tables are hot, but far fewer
+ * L1 misses when called cold among other hot code.
+ */
+static uint32_t crc32_nib(const uint8_t *in, size_t size, uint32_t crc)
+{
+    CRC32_TM_CALL(CRC32_TM_NIB, size);
+
+    const uint32_t (*t)[16] = crc32_nib_tbl;
+
+    while (size && ((uintptr_t)in & 3)) {
+        crc ^= *in++;
+        crc = (crc >> 8) ^ t[6][crc & 0xF] ^ t[7][(crc >> 4) & 0xF];
+        --size;
+    }
+
+    const uint32_t *in32 = (const uint32_t *)in;
+    while (size >= 4) {
+        crc ^= *in32++;
+        crc = t[0][crc & 0xF] ^ t[1][(crc >> 4) & 0xF] ^
+              t[2][(crc >> 8) & 0xF] ^ t[3][(crc >> 12) & 0xF] ^
+              t[4][(crc >> 16) & 0xF] ^ t[5][(crc >> 20) & 0xF] ^
+              t[6][(crc >> 24) & 0xF] ^ t[7][crc >> 28];
+        size -= 4;
+    }
+
+    in = (const uint8_t *)in32;
+    while (size--) {
+        crc ^= *in++;
+        crc = (crc >> 8) ^ t[6][crc & 0xF] ^ t[7][(crc >> 4) & 0xF];
+    }
+
+    return crc;
+}
+
+/*
+ * Software path dispatcher. Sizes are bucketed into classes up to 16, 64,
+ * 256, 1K and 4K bytes (larger calls use the 4K class), and each class goes
+ * to crc32_nib or crc32_lut4. crc-compact measures both under L1 pollution,
+ * picks per class and prints the crc32_sw_nib initializer for the host.
+ * Defaults below are from an x86 VM; crc32_lut4 is faster hot, so a class
+ * only goes to crc32_nib on a clear cold win.
+ */
+#define CRC32_SW_CLASSES    5
+
+static const size_t crc32_sw_class[CRC32_SW_CLASSES] = {
+    16, 64, 256, 1024, 4096
+};
+static uint8_t crc32_sw_nib[CRC32_SW_CLASSES] = { 0, 1, 0, 0, 0 };
+
+static uint32_t crc32_sw(const uint8_t *in, size_t size, uint32_t crc)
+{
+    int c = 0;
+
+    while (c < CRC32_SW_CLASSES - 1 && size > crc32_sw_class[c])
+        ++c;
+    if (crc32_sw_nib[c])
+        return crc32_nib(in, size, crc);
+    return crc32_lut4(in, size, crc);
+}
+
+/*
+ * PSHUFB engine for any 32-bit reflected polynomial.
+ *
+ * The buffer is split into 16 lanes, one CRC per byte of a xmm register.
+ * CRCs are kept in 4 byte planes r0..r3 (r0 holds the low byte of all 16
+ * CRCs). One step consumes one byte of every lane:
+ *   idx = r0 ^ data
+ *   T[idx] = T[idx & 0xF] ^ T[idx & 0xF0], each 16 entries, looked up per
+ *   byte plane by pshufb from registers, no table loads.
+ * Lane data is gathered by 16x16 byte transposes. Lane CRCs are combined
+ * with crc * x^(8*lane_len) mod P in software, once per call.
+ */
+struct crc32_pshufb_ctx {
+    uint8_t lo[4][16];      /* byte b of T[n] */
+    uint8_t hi[4][16];      /* byte b of T[n << 4] */
+    uint32_t tbl[256];      /* scalar tail */
+    uint32_t xp2[64];       /* x^(2^k) mod P */
+    uint32_t poly;
+};
+
+/* a * b mod P, bit-reflected, 0x80000000 is x^0 */
+static uint32_t multmodp(uint32_t a, uint32_t b, uint32_t p)
+{
+    uint32_t m = 1U << 31, r = 0;
+
+    while (m) {
+        if (a & m)
+            r ^= b;
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ p : b >> 1;
+    }
+
+    return r;
+}
+
+/* x^(8*n) mod P */
+static uint32_t x8nmodp(const struct crc32_pshufb_ctx *ctx, uint64_t n)
+{
+    uint32_t r = 1U << 31;
+
+    for (int k = 3; n; k++, n >>= 1) {
+        if (n & 1)
+            r = multmodp(ctx->xp2[k], r, ctx->poly);
+    }
+
+    return r;
+}
+
+static void crc32_pshufb_init(struct crc32_pshufb_ctx *ctx, uint32_t poly)
+{
+    ctx->poly = poly;
+
+    for (int i = 0; i < 256; ++i)
+        ctx->tbl[i] = crc32_naive_u8(i, poly);
+
+    for (int n = 0; n < 16; ++n) {
+        for (int b = 0; b < 4; ++b) {
+            ctx->lo[b][n] = ctx->tbl[n] >> (b * 8);
+            ctx->hi[b][n] = ctx->tbl[n << 4] >> (b * 8);
+        }
+    }
+
+    ctx->xp2[0] = 1U << 30;     /* x^1 */
+    for (int k = 1; k < 64; ++k)
+        ctx->xp2[k] = multmodp(ctx->xp2[k-1], ctx->xp2[k-1], poly);
+}
+
+static uint32_t crc32_pshufb(const struct crc32_pshufb_ctx *ctx,
+                             const uint8_t *in, size_t size, uint32_t crc)
+{
+    CRC32_TM_CALL(CRC32_TM_PSHUFB, size);
+
+#ifdef __SSSE3__
+    if (size >= 256) {
+        /* lane length, multiple of 16 */
+        const size_t len = size / 256 * 16;
+        const __m128i m0f = _mm_set1_epi8(0x0F);
+        __m128i lo[4], hi[4], r[4];
+
+        for (int b = 0; b < 4; ++b) {
+            lo[b] = _mm_loadu_si128((const __m128i *)ctx->lo[b]);
+            hi[b] = _mm_loadu_si128((const __m128i *)ctx->hi[b]);
+            r[b] = _mm_cvtsi32_si128((crc >> (b * 8)) & 0xFF);
+        }
+
+        for (size_t off = 0; off < len; off += 16) {
+            __m128i v[16], w[16];
+
+            for (int s = 0; s < 16; ++s)
+                v[s] = _mm_loadu_si128((const __m128i *)(in + s*len + off));
+
+            /* transpose, v[t] byte s = lane s byte t */
+            for (int round = 0; round < 4; ++round) {
+                for (int i = 0; i < 8; ++i) {
+                    w[2*i] = _mm_unpacklo_epi8(v[i], v[i+8]);
+                    w[2*i+1] = _mm_unpackhi_epi8(v[i], v[i+8]);
+                }
+                for (int i = 0; i < 16; ++i)
+                    v[i] = w[i];
+            }
+
+            for (int t = 0; t < 16; ++t) {
+                __m128i idx = _mm_xor_si128(r[0], v[t]);
+                __m128i l = _mm_and_si128(idx, m0f);
+                __m128i h = _mm_and_si128(_mm_srli_epi16(idx, 4), m0f);
+
+                r[0] = _mm_xor_si128(r[1], _mm_xor_si128(
+                       _mm_shuffle_epi8(lo[0], l), _mm_shuffle_epi8(hi[0], h)));
+                r[1] = _mm_xor_si128(r[2], _mm_xor_si128(
+                       _mm_shuffle_epi8(lo[1], l), _mm_shuffle_epi8(hi[1], h)));
+                r[2] = _mm_xor_si128(r[3], _mm_xor_si128(
+                       _mm_shuffle_epi8(lo[2], l), _mm_shuffle_epi8(hi[2], h)));
+                r[3] = _mm_xor_si128(
+                       _mm_shuffle_epi8(lo[3], l), _mm_shuffle_epi8(hi[3], h));
+            }
+        }
+
+        uint8_t planes[4][16];
+        for (int b = 0; b < 4; ++b)
+            _mm_storeu_si128((__m128i *)planes[b], r[b]);
+
+        /* CRC(A|B) = CRC(A) * x^(8*|B|) ^ CRC(B), lanes 1..15 start at 0 */
+        const uint32_t xn = x8nmodp(ctx, len);
+        crc = 0;
+        for (int s = 0; s < 16; ++s) {
+            uint32_t c = planes[0][s] | planes[1][s] << 8 |
+                         planes[2][s] << 16 | (uint32_t)planes[3][s] << 24;
+            crc = multmodp(xn, crc, ctx->poly) ^ c;
+        }
+
+        in += len * 16;
+        size -= len * 16;
+    }
+#endif
+
+    while (size--) {
+        crc = (crc >> 8) ^ ctx->tbl[(crc ^ *in++) & 0xFF];
+    }
+
+    return crc;
+}
+
+/*
+ * CRC-64 for reflected polynomials, e.g.
+ *   CRC-64/XZ    0xC96C5795D7870F42 (ECMA-182 polynomial, reflected)
+ *   CRC-64/NVME  0x9A6C9329AC4BC9B5
+ * Constants are derived from the polynomial by crc64_init, so any of them
+ * can be selected per context.
+ *
+ * Reflected u64 bit i is x^(63-i). clmul of two such values read as a
+ * reflected u128 is a * b * x, hence x^(n-1) fold constants.
+ */
+struct crc64_ctx {
+    uint64_t tbl[8][256];   /* slicing by 8 */
+    uint64_t k575, k511;    /* x^(512+64-1), x^(512-1) mod P, fold by 4 */
+    uint64_t k191, k127;    /* x^(128+64-1), x^(128-1) mod P, fold by 1 */
+    uint64_t mu;            /* floor(x^128 / P), x^64 term implied */
+    uint64_t poly;          /* P, x^64 term implied */
+};
+
+static uint64_t crc64_naive(const uint8_t *in, size_t size, uint64_t crc,
+                            uint64_t p)
+{
+    for (size_t i = 0; i < size; i++) {
+        crc ^= in[i];
+        for (int k = 0; k < 8; k++)
+            crc = (crc & 1) ? (crc >> 1) ^ p : crc >> 1;
+    }
+
+    return crc;
+}
+
+/* x^n mod P, n >= 63 */
+static uint64_t crc64_xnmodp(uint64_t p, int n)
+{
+    uint64_t r = 1;     /* x^63 */
+
+    for (n -= 63; n > 0; n--)
+        r = (r & 1) ? (r >> 1) ^ p : r >> 1;
+
+    return r;
+}
+
+static uint64_t bitrev64(uint64_t v)
+{
+    uint64_t r = 0;
+
+    for (int i = 0; i < 64; i++, v >>= 1)
+        r = (r << 1) | (v & 1);
+
+    return r;
+}
+
+static void crc64_init(struct crc64_ctx *ctx, uint64_t poly)
+{
+    ctx->poly = poly;
+
+    for (int i = 0; i < 256; ++i) {
+        uint8_t b = i;
+        ctx->tbl[0][i] = crc64_naive(&b, 1, 0, poly);
+    }
+    for (int k = 1; k < 8; ++k) {
+        for (int i = 0; i < 256; ++i) {
+            uint64_t c = ctx->tbl[k-1][i];
+            ctx->tbl[k][i] = (c >> 8) ^ ctx->tbl[0][c & 0xFF];
+        }
+    }
+
+    ctx->k575 = crc64_xnmodp(poly, 575);
+    ctx->k511 = crc64_xnmodp(poly, 511);
+    ctx->k191 = crc64_xnmodp(poly, 191);
+    ctx->k127 = crc64_xnmodp(poly, 127);
+
+    /* x^128 / P in normal bit order, the x^128 step leaves P * x^64 */
+    const unsigned __int128 pn = ((unsigned __int128)1 << 64) | bitrev64(poly);
+    unsigned __int128 r = (unsigned __int128)bitrev64(poly) << 64;
+    uint64_t q = 0;
+    for (int d = 127; d >= 64; --d) {
+        if ((r >> d) & 1) {
+            q |= 1ULL << (d - 64);
+            r ^= pn << (d - 64);
+        }
+    }
+    ctx->mu = bitrev64(q);
+}
+
+static uint64_t crc64_lut8(const struct crc64_ctx *ctx, const uint8_t *in,
+                           size_t size, uint64_t crc)
+{
+    const uint64_t (*t)[256] = ctx->tbl;
+
+    CRC32_TM_CALL(CRC32_TM_CRC64_LUT8, size);
+
+    while (size >= 8) {
+        crc ^= *(const uint64_t *)in;
+        crc = t[7][crc & 0xFF] ^ t[6][(crc >> 8) & 0xFF] ^
+              t[5][(crc >> 16) & 0xFF] ^ t[4][(crc >> 24) & 0xFF] ^
+              t[3][(crc >> 32) & 0xFF] ^ t[2][(crc >> 40) & 0xFF] ^
+              t[1][(crc >> 48) & 0xFF] ^ t[0][crc >> 56];
+        in += 8;
+        size -= 8;
+    }
+    while (size--)
+        crc = (crc >> 8) ^ t[0][(crc ^ *in++) & 0xFF];
+
+    return crc;
+}
+
+static uint64_t crc64_fold(const struct crc64_ctx *ctx, const uint8_t *in,
+                           size_t size, uint64_t crc)
+{
+    CRC32_TM_CALL(CRC32_TM_CRC64_FOLD, size);
+
+#ifdef __aarch64__
+    return crc64_lut8(ctx, in, size, crc);
+#else
+    const size_t blocks = size / 16;
+
+    if (blocks < 1)
+        return crc64_lut8(ctx, in, size, crc);
+
+    /* V.lo is H (x^127..x^64), V.hi is L: V * x^128 = H * x^192 + L * x^128 */
+    const __m128i k1 = _mm_set_epi64x(ctx->k127, ctx->k191);
+    __m128i next = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in),
+                                 _mm_set_epi64x(0, crc));
+    size_t i = 1;
+
+/* v = v.lo * k.lo ^ v.hi * k.hi ^ d */
+#define CRC64_FOLD(v, k, d)                                     \
+    v = _mm_xor_si128(_mm_xor_si128(                            \
+            _mm_clmulepi64_si128(v, k, 0x00),                   \
+            _mm_clmulepi64_si128(v, k, 0x11)), d)
+
+    if (blocks >= 8) {
+        const __m128i k4 = _mm_set_epi64x(ctx->k511, ctx->k575);
+        __m128i v0 = next;
+        __m128i v1 = _mm_loadu_si128((const __m128i *)(in+16));
+        __m128i v2 = _mm_loadu_si128((const __m128i *)(in+32));
+        __m128i v3 = _mm_loadu_si128((const __m128i *)(in+48));
+
+        for (i = 4; i + 4 <= blocks; i += 4) {
+            const uint8_t *p = in + i*16;
+            CRC64_FOLD(v0, k4, _mm_loadu_si128((const __m128i *)(p)));
+            CRC64_FOLD(v1, k4, _mm_loadu_si128((const __m128i *)(p+16)));
+            CRC64_FOLD(v2, k4, _mm_loadu_si128((const __m128i *)(p+32)));
+            CRC64_FOLD(v3, k4, _mm_loadu_si128((const __m128i *)(p+48)));
+        }
+
+        next = v0;
+        CRC64_FOLD(next, k1, v1);
+        CRC64_FOLD(next, k1, v2);
+        CRC64_FOLD(next, k1, v3);
+    }
+
+    for (in += i*16; i < blocks; ++i, in += 16)
+        CRC64_FOLD(next, k1, _mm_loadu_si128((const __m128i *)in));
+#undef CRC64_FOLD
+
+    /* T = H * x^128 + L * x^64 = V * x^64, congruent mod P, 128 bits */
+    __m128i t = _mm_xor_si128(_mm_clmulepi64_si128(next, k1, 0x10),
+                              _mm_srli_si128(next, 8));
+
+    /*
+     * Barrett, T = Th * x^64 + Tl:
+     *   q = floor(Th * mu / x^64) = Th + floor(Th * mu' / x^64)
+     *   crc = Tl + (q * P' mod x^64)
+     * clmul leaves one bit of x, fixed by the 1-bit shifts.
+     */
+    const __m128i kb = _mm_set_epi64x(ctx->poly, ctx->mu);
+    const uint64_t th = _mm_cvtsi128_si64(t);
+    const uint64_t tl = _mm_extract_epi64(t, 1);
+
+    __m128i c = _mm_clmulepi64_si128(t, kb, 0x00);
+    const uint64_t q = th ^ ((uint64_t)_mm_cvtsi128_si64(c) << 1);
+
+    c = _mm_clmulepi64_si128(_mm_cvtsi64_si128(q), kb, 0x10);
+    crc = tl ^ ((uint64_t)_mm_extract_epi64(c, 1) << 1) ^
+          ((uint64_t)_mm_cvtsi128_si64(c) >> 63);
+
+    return crc64_lut8(ctx, in, size % 16, crc);
+#endif
+}
+
+static uint32_t crc32_ieee_lut(const uint8_t *in, size_t size, uint32_t crc)
+{
+    while (size--)
+        crc = (crc >> 8) ^ crc32_ieee_tbl[(crc ^ *in++) & 0xFF];
+
+    return crc;
+}
+
+/*
+ * CRC32C and CRC32 (IEEE, zlib polynomial) in one pass, raw CRCs as
+ * crc32_hw (zlib's crc32(c, ...) is ~crc32_dual(~c)).
+ *
+ * Blocks of 3 lanes x 256 bytes. Every 16 bytes of a lane are fed to the
+ * crc32c instruction stream and to a CLMUL fold of that lane while still in
+ * L1, like pmull_crc_poc does, so the two streams run on different ports.
+ * At block end CRC32C lanes merge as in crc32_hw; IEEE lanes are shifted by
+ * 512 and 256 bytes with clmul and xored into one 128-bit remainder, which
+ * is folded into the first lane of the next block.
+ * c = 0 drops the crc32c stream, leaving a CLMUL only IEEE pass.
+ */
+static inline __attribute__((always_inline))
+void crc32_dual_(const uint8_t *in, size_t size, uint32_t *crc32c,
+                 uint32_t *crc32, const int c)
+{
+    uint32_t crc = *crc32c;
+    uint32_t ieee = *crc32;
+
+#ifndef __aarch64__
+    if (size >= 768) {
+        /* IEEE x^(n-32) mod P, n = 8*shift+64-1 (low), 8*shift-1 (high) */
+        const __m128i k16 = _mm_set_epi64x(0xccaa009e, 0xae689191);
+        const __m128i k256 = _mm_set_epi64x(0xe95c1271, 0xce3371cb);
+        const __m128i k512 = _mm_set_epi64x(0x0c30f51d, 0x1072db28);
+        __m128i v = _mm_cvtsi32_si128(ieee);
+        int first = 1;
+
+#define CRC32_DUAL_FOLD(a, k)                                       \
+        _mm_xor_si128(_mm_clmulepi64_si128(a, k, 0x00),             \
+                      _mm_clmulepi64_si128(a, k, 0x11))
+
+        while (size >= 768) {
+            const uint64_t *in64 = (const uint64_t *)in;
+            uint32_t crc0 = crc, crc1 = 0, crc2 = 0;
+            __m128i a0 = _mm_loadu_si128((const __m128i *)in);
+            __m128i a1 = _mm_loadu_si128((const __m128i *)(in+256));
+            __m128i a2 = _mm_loadu_si128((const __m128i *)(in+512));
+
+            /* previous remainder, or the initial CRC, goes to lane 0 */
+            if (first)
+                a0 = _mm_xor_si128(a0, v);
+            else
+                a0 = _mm_xor_si128(a0, CRC32_DUAL_FOLD(v, k16));
+            first = 0;
+
+            for (int i = 0; i < 32; i += 2) {
+                if (i) {
+                    a0 = _mm_xor_si128(CRC32_DUAL_FOLD(a0, k16),
+                            _mm_loadu_si128((const __m128i *)(in64+i)));
+                    a1 = _mm_xor_si128(CRC32_DUAL_FOLD(a1, k16),
+                            _mm_loadu_si128((const __m128i *)(in64+32+i)));
+                    a2 = _mm_xor_si128(CRC32_DUAL_FOLD(a2, k16),
+                            _mm_loadu_si128((const __m128i *)(in64+64+i)));
+                }
+                if (!c)
+                    continue;
+                crc0 = crc32c_u64(crc0, in64[i]);
+                crc1 = crc32c_u64(crc1, in64[32+i]);
+                crc2 = crc32c_u64(crc2, in64[64+i]);
+                crc0 = crc32c_u64(crc0, in64[i+1]);
+                crc1 = crc32c_u64(crc1, in64[32+i+1]);
+                crc2 = crc32c_u64(crc2, in64[64+i+1]);
+            }
+
+            /* x^(256*8*2-32-1), x^(256*8-32-1) mod P */
+            if (c) {
+                crc0 = crc32c_u64(0, vmull_p32(crc0, 0xdd7e3b0c));
+                crc1 = crc32c_u64(0, vmull_p32(crc1, 0xb9e02b86));
+                crc = crc0 ^ crc1 ^ crc2;
+            }
+
+            v = _mm_xor_si128(_mm_xor_si128(CRC32_DUAL_FOLD(a0, k512),
+                                            CRC32_DUAL_FOLD(a1, k256)), a2);
+
+            in += 768;
+            size -= 768;
+        }
+
+        while (size >= 16) {
+            v = _mm_xor_si128(CRC32_DUAL_FOLD(v, k16),
+                              _mm_loadu_si128((const __m128i *)in));
+            if (c) {
+                crc = crc32c_u64(crc, *(const uint64_t *)in);
+                crc = crc32c_u64(crc, *(const uint64_t *)(in+8));
+            }
+            in += 16;
+            size -= 16;
+        }
+#undef CRC32_DUAL_FOLD
+
+        /* remainder * x^32 mod P is the CRC of its 16 bytes */
+        uint8_t data[16];
+        _mm_storeu_si128((__m128i *)data, v);
+        ieee = crc32_ieee_lut(data, 16, 0);
+    }
+#endif
+
+    if (c)
+        *crc32c = crc32_hw(in, size, crc);
+    *crc32 = crc32_ieee_lut(in, size, ieee);
 }
 
-static uint32_t crc32_lut4(const uint8_t *in, size_t size, uint32_t crc)
+static void crc32_dual(const uint8_t *in, size_t size, uint32_t *crc32c,
+                       uint32_t *crc32)
 {
-    const int unaligned = (uintptr_t)in & 3;
-    if (unaligned) {
-        int align = 4 - unaligned;
-        if (align > size)
-            align = size;
-        crc = crc32_lut(in, align, crc);
-        in += align;
-        size -= align;
-    }
+    CRC32_TM_CALL(CRC32_TM_DUAL, size);
+    crc32_dual_(in, size, crc32c, crc32, 1);
+}
 
-    const uint32_t *in32 = (const uint32_t *)in;
-    while (size >= 4) {
-        crc ^= *in32++;
-        crc = crc32_tbl[3][crc & 0xFF] ^
-              crc32_tbl[2][(crc >> 8) & 0xFF] ^
-              crc32_tbl[1][(crc >> 16) & 0xFF] ^
-              crc32_tbl[0][crc >> 24];
-        size -= 4;
-    }
+/* IEEE CRC alone, the second pass crc-dual compares crc32_dual against */
+static uint32_t crc32_ieee_fold(const uint8_t *in, size_t size, uint32_t crc)
+{
+    uint32_t unused = 0;
 
-    return crc32_lut((const uint8_t *)in32, size, crc);
+    crc32_dual_(in, size, &unused, &crc, 0);
+    return crc;
 }
 
 static uint32_t crc32_fold(const uint8_t *in, size_t size, uint32_t crc)
 {
+    CRC32_TM_CALL(CRC32_TM_FOLD, size);
+
 #ifdef __aarch64__
     printf("Not implemented yet!");
     return 0;
@@ -218,7 +1274,7 @@ static uint32_t crc32_fold(const uint8_t *in, size_t size, uint32_t crc)
     }
 
     const int blocks = size / 16;
-    const int residue = size % 16;
+    const int residue = blocks > 1 ? size % 16 : size;
 
     if (blocks > 1) {
         const uint32_t k0 = 0xf20c0dfe;     /* x^(64+128-32-1) mod P */
@@ -241,7 +1297,7 @@ static uint32_t crc32_fold(const uint8_t *in, size_t size, uint32_t crc)
             h = _mm_clmulepi64_si128(vk, next, 0x00);
             l = _mm_clmulepi64_si128(vk, next, 0x11);
 
-            next = _mm_load_si128((__m128i *)(in+16));
+            next = _mm_loadu_si128((__m128i *)(in+16));
 
             next = _mm_xor_si128(next, h);
             next = _mm_xor_si128(next, l);
@@ -316,14 +1372,768 @@ static void test_pmul(void)
 }
 #endif
 
+#ifndef CRC32_LIB
+/* seconds since tv */
+static double elapsed(const struct timeval *tv)
+{
+    struct timeval now;
+
+    gettimeofday(&now, 0);
+    return (now.tv_sec - tv->tv_sec) + (now.tv_usec - tv->tv_usec) / 1e6;
+}
+
+#ifdef CRC32_PREFETCH
+/*
+ * Cold data benchmark. Buffer is much larger than LLC so every pass streams
+ * from DRAM, unlike main() which runs warm in cache.
+ */
+static double bench_cold(uint32_t (*fn)(const uint8_t *, size_t, uint32_t),
+                         const uint8_t *in, size_t size, int loops,
+                         uint32_t *crc)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, 0);
+    for (int i = 0; i < loops; ++i)
+        *crc = fn(in, size, *crc);
+
+    const double time = elapsed(&tv);
+    return ((double)size * loops) / (1024*1024) / time;
+}
+
+static int bench_prefetch(int argc, const char *argv[])
+{
+    const size_t size = 512 * 1024 * 1024;
+    const int loops = 8;
+    uint8_t *in;
+    uint32_t c1 = 0, c2 = 0, c3 = 0;
+
+    if (argc > 1)
+        crc32_pf_dist = strtoul(argv[1], NULL, 0);
+
+    if (posix_memalign((void **)&in, 4096, size)) {
+        printf("alloc failed\n");
+        return 1;
+    }
+    for (size_t i = 0; i < size; ++i)
+        in[i] = i+1;
+
+    printf("cold data: %zu MB, prefetch distance: %zu bytes\n",
+           size / (1024*1024), crc32_pf_dist);
+    printf("crc32_hw:        %.2f MB/s\n", bench_cold(crc32_hw, in, size, loops, &c1));
+    printf("crc32_hw_pf:     %.2f MB/s\n", bench_cold(crc32_hw_pf, in, size, loops, &c2));
+    printf("crc32_hw_pf_nta: %.2f MB/s\n", bench_cold(crc32_hw_pf_nta, in, size, loops, &c3));
+
+    free(in);
+
+    if (c1 == c2 && c1 == c3) {
+        printf("OK\n");
+        return 0;
+    }
+    printf("BAD: %x, %x, should be %x\n", c2, c3, c1);
+    return 1;
+}
+#endif
+
+#ifdef CRC32_LATENCY
+static const struct {
+    const char *name;
+    uint32_t (*fn)(const uint8_t *, size_t, uint32_t);
+} engines[] = {
+    { "crc32_lut",  crc32_lut },
+    { "crc32_lut4", crc32_lut4 },
+    { "crc32_nib",  crc32_nib },
+    { "crc32_sw",   crc32_sw },
+    { "crc32_hw",   crc32_hw },
+    { "crc32_hw_pf", crc32_hw_pf },
+#ifndef __aarch64__
+    { "crc32_fold", crc32_fold },
+#endif
+};
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint64_t xorshift(uint64_t *s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+/*
+ * Per call latency. Sizes are random in (class/2, class], offsets random in
+ * the buffer, so neither branch predictor nor alignment is warmed for one
+ * shape. Timer overhead (min of empty measurements) is subtracted.
+ */
+static int bench_latency(void)
+{
+    static const int classes[] = { 16, 64, 256, 1024, 4096 };
+    const int samples = 100000;
+    const size_t buf_size = 64 * 1024;
+    uint8_t *in = malloc(buf_size);
+    uint32_t *off = malloc(samples * sizeof(uint32_t));
+    uint32_t *len = malloc(samples * sizeof(uint32_t));
+    uint64_t *t = malloc(samples * sizeof(uint64_t));
+    uint64_t seed = 0x2019;
+    uint32_t crc = 0;
+    int bad = 0;
+
+    for (size_t i = 0; i < buf_size; ++i)
+        in[i] = xorshift(&seed);
+
+    const double ns = tick_ns();
+    uint64_t overhead = UINT64_MAX;
+    for (int i = 0; i < samples; ++i) {
+        uint64_t t1 = tick();
+        uint64_t t2 = tick();
+        if (t2 - t1 < overhead)
+            overhead = t2 - t1;
+    }
+    printf("tick: %.3f ns, overhead: %" PRIu64 " ticks\n", ns, overhead);
+
+    for (int c = 0; c < sizeof(classes) / sizeof(classes[0]); ++c) {
+        const int cls = classes[c];
+
+        for (int i = 0; i < samples; ++i) {
+            len[i] = cls / 2 + 1 + xorshift(&seed) % (cls / 2);
+            off[i] = xorshift(&seed) % (buf_size - len[i]);
+        }
+
+        printf("\nsize <= %-5d  %8s %8s %8s %8s  (ns)\n",
+               cls, "p50", "p90", "p99", "p99.9");
+
+        for (int e = 0; e < sizeof(engines) / sizeof(engines[0]); ++e) {
+            uint32_t (*fn)(const uint8_t *, size_t, uint32_t) = engines[e].fn;
+
+            for (int i = 0; i < 1000; ++i) {
+                if (fn(in + off[i], len[i], i) !=
+                        crc32_lut(in + off[i], len[i], i))
+                    bad = 1;
+            }
+
+            for (int i = 0; i < samples; ++i) {
+                uint64_t t1 = tick();
+                crc = fn(in + off[i], len[i], crc);
+                uint64_t t2 = tick();
+                t[i] = t2 - t1 - overhead;
+            }
+            qsort(t, samples, sizeof(uint64_t), cmp_u64);
+
+            printf("%-12s  %8.1f %8.1f %8.1f %8.1f\n", engines[e].name,
+                   t[samples / 2] * ns, t[samples * 90 / 100] * ns,
+                   t[samples * 99 / 100] * ns, t[samples * 999 / 1000] * ns);
+        }
+    }
+
+    free(in);
+    free(off);
+    free(len);
+    free(t);
+
+    printf("\n%s (%x)\n", bad ? "BAD" : "OK", crc);
+    return bad;
+}
+#endif
+
+#ifdef CRC32_FIXED
+static int bench_fixed(void)
+{
+    static const struct {
+        size_t size;
+        uint32_t (*fn)(const void *, uint32_t);
+    } fixed[] = {
+        { 512,   crc32c_512 },
+        { 4096,  crc32c_4k },
+        { 65536, crc32c_64k },
+    };
+    const size_t size = 1024 * 1024;
+    const int loops = 2019;
+    uint8_t *in;
+    struct timeval tv;
+    int bad = 0;
+
+    if (posix_memalign((void **)&in, 4096, size)) {
+        printf("alloc failed\n");
+        return 1;
+    }
+    for (size_t i = 0; i < size; ++i)
+        in[i] = i+1;
+
+    for (int f = 0; f < sizeof(fixed) / sizeof(fixed[0]); ++f) {
+        const size_t page = fixed[f].size;
+        uint32_t c1 = 0, c2 = 0;
+        double time, time_hw;
+
+        gettimeofday(&tv, 0);
+        for (int i = 0; i < loops; ++i)
+            for (size_t off = 0; off < size; off += page)
+                c1 = crc32_hw(in + off, page, c1);
+        time_hw = elapsed(&tv);
+        printf("%5zu crc32_hw:   %.2f MB/s\n", page, (double)size * loops / (1024*1024) / time_hw);
+
+        gettimeofday(&tv, 0);
+        for (int i = 0; i < loops; ++i)
+            for (size_t off = 0; off < size; off += page)
+                c2 = fixed[f].fn(in + off, c2);
+        time = elapsed(&tv);
+        printf("%5zu fixed:      %.2f MB/s (x%.2f)\n", page,
+               (double)size * loops / (1024*1024) / time, time_hw / time);
+
+        if (c1 != c2) {
+            printf("BAD: %x, should be %x\n", c2, c1);
+            bad = 1;
+        }
+    }
+
+    free(in);
+
+    if (!bad)
+        printf("OK\n");
+    return bad;
+}
+#endif
+
+#ifdef CRC32_COMPACT
+static volatile uint64_t pollute_sink;
+
+/* touch 64K, more than L1D, like hot code interleaved with CRC calls */
+static void pollute(const uint64_t *buf)
+{
+    uint64_t sum = 0;
+
+    for (int i = 0; i < 64 * 1024 / 8; i += 8)
+        sum += buf[i];
+    pollute_sink = sum;
+}
+
+/* average ns per call, buf != NULL pollutes L1 before every call */
+static double bench_call(uint32_t (*fn)(const uint8_t *, size_t, uint32_t),
+                         const uint8_t *in, size_t size, const uint64_t *buf,
+                         double ns, uint32_t *crc)
+{
+    const int loops = 100000;
+    uint64_t t = 0;
+
+    for (int i = 0; i < loops; ++i) {
+        if (buf)
+            pollute(buf);
+        uint64_t t1 = tick();
+        *crc = fn(in, size, *crc);
+        t += tick() - t1;
+    }
+
+    return ns * t / loops;
+}
+
+/*
+ * Per call cost with tables hot, and cold with 64K touched before every
+ * call. Each crc32_sw class goes to crc32_nib only if it wins cold by more
+ * than CRC32_SW_MARGIN, ties stay on crc32_lut4 which is faster hot. The
+ * choices are printed as an initializer to commit for the target host.
+ */
+#define CRC32_SW_MARGIN     0.9
+
+static int bench_compact(void)
+{
+    uint8_t in[4096];
+    uint64_t *buf = malloc(64 * 1024);
+    uint32_t c1 = 0, c2 = 0, c3 = 0, c4 = 0;
+    int bad = 0;
+
+    for (int i = 0; i < sizeof(in); ++i)
+        in[i] = i+1;
+    for (int i = 0; i < 64 * 1024 / 8; ++i)
+        buf[i] = i;
+
+    const double ns = tick_ns();
+
+    printf("%-6s %12s %12s %12s %12s %12s  (ns)\n", "size",
+           "lut4", "nib", "lut4 cold", "nib cold", "sw cold");
+    for (int c = 0; c < CRC32_SW_CLASSES; ++c) {
+        const size_t size = crc32_sw_class[c];
+        double lut4 = bench_call(crc32_lut4, in, size, NULL, ns, &c1);
+        double nib = bench_call(crc32_nib, in, size, NULL, ns, &c2);
+        double lut4_cold = bench_call(crc32_lut4, in, size, buf, ns, &c1);
+        double nib_cold = bench_call(crc32_nib, in, size, buf, ns, &c2);
+
+        crc32_sw_nib[c] = nib_cold < lut4_cold * CRC32_SW_MARGIN;
+
+        double sw_cold = bench_call(crc32_sw, in, size, buf, ns, &c3);
+        bench_call(crc32_lut4, in, size, NULL, ns, &c4);
+
+        printf("%-6zu %12.1f %12.1f %12.1f %12.1f %12.1f  %s\n",
+               size, lut4, nib, lut4_cold, nib_cold, sw_cold,
+               crc32_sw_nib[c] ? "nib" : "lut4");
+    }
+
+    printf("static uint8_t crc32_sw_nib[CRC32_SW_CLASSES] = {");
+    for (int c = 0; c < CRC32_SW_CLASSES; ++c)
+        printf(" %d%s", crc32_sw_nib[c], c < CRC32_SW_CLASSES - 1 ? "," : " };\n");
+
+    if (c1 != c2 || c3 != c4) {
+        printf("BAD: %x %x, should be %x %x\n", c2, c3, c1, c4);
+        bad = 1;
+    }
+    for (size_t n = 0; n <= sizeof(in); ++n) {
+        if (crc32_sw(in, n, 1) != crc32_lut4(in, n, 1)) {
+            printf("BAD crc32_sw: %zu\n", n);
+            bad = 1;
+            break;
+        }
+    }
+
+    free(buf);
+
+    if (!bad)
+        printf("OK\n");
+    return bad;
+}
+#endif
+
+#ifdef CRC32_PSHUFB
+static int bench_pshufb(void)
+{
+    static const struct {
+        const char *name;
+        uint32_t poly;
+    } polys[] = {
+        { "CRC-32C",  0x82F63B78 },
+        { "CRC-32",   0xEDB88320 },
+        { "CRC-32K",  0xEB31D82E },
+        { "CRC-32Q",  0xD5828281 },
+        { "random",   0x2019ACE5 },
+    };
+    const size_t size = 1024 * 1024 + 3;
+    const int loops = 2019;
+    uint8_t *in = malloc(size);
+    struct crc32_pshufb_ctx ctx;
+    struct timeval tv;
+    uint64_t seed = 0x2019;
+    int bad = 0;
+
+    for (size_t i = 0; i < size; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        in[i] = seed >> 56;
+    }
+
+    for (int p = 0; p < sizeof(polys) / sizeof(polys[0]); ++p) {
+        crc32_pshufb_init(&ctx, polys[p].poly);
+
+        for (int n = 0; n < 5000; n += 7) {
+            const int off = n % 61;
+            const uint32_t init = n * 0x9E3779B9;
+            if (crc32_pshufb(&ctx, in + off, n, init) !=
+                    crc32_naive_p(in + off, n, init, polys[p].poly)) {
+                printf("BAD: %s, size %d\n", polys[p].name, n);
+                bad = 1;
+                break;
+            }
+        }
+    }
+
+    crc32_pshufb_init(&ctx, 0x82F63B78);
+    if (crc32_pshufb(&ctx, in, size, 0) != crc32_hw(in, size, 0)) {
+        printf("BAD: CRC-32C against crc32_hw\n");
+        bad = 1;
+    }
+
+    uint32_t c1 = 0, c2 = 0;
+    double time;
+
+    gettimeofday(&tv, 0);
+    for (int i = 0; i < loops; ++i)
+        c1 = crc32_lut4(in, size, c1);
+    time = elapsed(&tv);
+    printf("crc32_lut4:   %.2f MB/s\n", (double)size * loops / (1024*1024) / time);
+
+    gettimeofday(&tv, 0);
+    for (int i = 0; i < loops; ++i)
+        c2 = crc32_pshufb(&ctx, in, size, c2);
+    time = elapsed(&tv);
+    printf("crc32_pshufb: %.2f MB/s\n", (double)size * loops / (1024*1024) / time);
+
+    if (c1 != c2) {
+        printf("BAD: %x, should be %x\n", c2, c1);
+        bad = 1;
+    }
+
+    free(in);
+
+    if (!bad)
+        printf("OK\n");
+    return bad;
+}
+#endif
+
+#ifdef CRC64
+static int bench_crc64(void)
+{
+    static const struct {
+        const char *name;
+        uint64_t poly;
+        uint64_t check;     /* "123456789", init and xorout ~0 */
+    } polys[] = {
+        { "CRC-64/XZ",     0xC96C5795D7870F42, 0x995DC9BBDF1939FA },
+        { "CRC-64/NVME",   0x9A6C9329AC4BC9B5, 0xAE8B14860A799888 },
+        { "CRC-64/GO-ISO", 0xD800000000000000, 0xB90956C775A41001 },
+    };
+    const size_t size = 1024 * 1024 + 3;
+    const int loops = 2019;
+    uint8_t *in = malloc(size);
+    struct crc64_ctx *ctx = malloc(sizeof(*ctx));
+    struct timeval tv;
+    int bad = 0;
+
+    for (size_t i = 0; i < size; ++i)
+        in[i] = i * 0x9E3779B1 >> 24;
+
+    for (int p = 0; p < sizeof(polys) / sizeof(polys[0]); ++p) {
+        const uint64_t poly = polys[p].poly;
+        crc64_init(ctx, poly);
+
+        uint64_t c1 = ~crc64_lut8(ctx, (const uint8_t *)"123456789", 9, ~0ULL);
+        uint64_t c2 = ~crc64_fold(ctx, (const uint8_t *)"123456789", 9, ~0ULL);
+        if (c1 != polys[p].check || c2 != polys[p].check) {
+            printf("BAD: %s check %" PRIx64 ", %" PRIx64 "\n", polys[p].name, c1, c2);
+            bad = 1;
+        }
+
+        for (int n = 0; n < 3000; n += 7) {
+            const int off = n % 13;
+            const uint64_t init = n * 0x9E3779B97F4A7C15ULL;
+            const uint64_t ref = crc64_naive(in + off, n, init, poly);
+            if (crc64_lut8(ctx, in + off, n, init) != ref ||
+                    crc64_fold(ctx, in + off, n, init) != ref) {
+                printf("BAD: %s, size %d\n", polys[p].name, n);
+                bad = 1;
+                break;
+            }
+        }
+    }
+
+    uint64_t c1 = 0, c2 = 0;
+    double time;
+
+    crc64_init(ctx, polys[0].poly);
+
+    gettimeofday(&tv, 0);
+    for (int i = 0; i < loops; ++i)
+        c1 = crc64_lut8(ctx, in, size, c1);
+    time = elapsed(&tv);
+    printf("crc64_lut8: %.2f MB/s\n", (double)size * loops / (1024*1024) / time);
+
+    gettimeofday(&tv, 0);
+    for (int i = 0; i < loops; ++i)
+        c2 = crc64_fold(ctx, in, size, c2);
+    time = elapsed(&tv);
+    printf("crc64_fold: %.2f MB/s\n", (double)size * loops / (1024*1024) / time);
+
+    if (c1 != c2) {
+        printf("BAD: %" PRIx64 ", should be %" PRIx64 "\n", c2, c1);
+        bad = 1;
+    }
+
+    free(ctx);
+    free(in);
+
+    if (!bad)
+        printf("OK\n");
+    return bad;
+}
+#endif
+
+#ifdef CRC32_DUAL
+static int bench_dual(void)
+{
+    const size_t size = 1024 * 1024 + 3;
+    const int loops = 2019;
+    uint8_t *in = malloc(size);
+    struct timeval tv;
+    int bad = 0;
+
+    for (size_t i = 0; i < size; ++i)
+        in[i] = i * 0x9E3779B1 >> 24;
+
+    for (int n = 0; n < 5000; n += 7) {
+        const int off = n % 13;
+        uint32_t c = n * 0x9E3779B9, i = ~c;
+        crc32_dual(in + off, n, &c, &i);
+        const uint32_t ref = crc32_naive_p(in + off, n, ~(n * 0x9E3779B9), 0xEDB88320);
+        if (c != crc32_hw(in + off, n, n * 0x9E3779B9) || i != ref ||
+                crc32_ieee_fold(in + off, n, ~(n * 0x9E3779B9)) != ref) {
+            printf("BAD: size %d\n", n);
+            bad = 1;
+            break;
+        }
+    }
+
+    uint32_t c1 = 0, i1 = 0, c2 = 0, i2 = 0;
+    double time;
+
+    /* two passes, both CLMUL/crc32c fast paths */
+    gettimeofday(&tv, 0);
+    for (int i = 0; i < loops; ++i) {
+        c1 = crc32_hw(in, size, c1);
+        i1 = ~crc32_ieee_fold(in, size, ~i1);
+    }
+    time = elapsed(&tv);
+    printf("crc32_hw + fold: %.2f MB/s\n", (double)size * loops / (1024*1024) / time);
+
+#ifdef CRC32_ZLIB
+    uint32_t c3 = 0, i3 = 0;
+
+    gettimeofday(&tv, 0);
+    for (int i = 0; i < loops; ++i) {
+        c3 = crc32_hw(in, size, c3);
+        i3 = crc32(i3, in, size);
+    }
+    time = elapsed(&tv);
+    printf("crc32_hw + zlib: %.2f MB/s\n", (double)size * loops / (1024*1024) / time);
+    if (c3 != c1 || i3 != i1) {
+        printf("BAD: zlib %x, should be %x\n", i3, i1);
+        bad = 1;
+    }
+#endif
+
+    gettimeofday(&tv, 0);
+    for (int i = 0; i < loops; ++i) {
+        i2 = ~i2;
+        crc32_dual(in, size, &c2, &i2);
+        i2 = ~i2;
+    }
+    time = elapsed(&tv);
+    printf("crc32_dual:      %.2f MB/s\n", (double)size * loops / (1024*1024) / time);
+
+    if (c1 != c2 || i1 != i2) {
+        printf("BAD: %x %x, should be %x %x\n", c2, i2, c1, i1);
+        bad = 1;
+    }
+
+    free(in);
+
+    if (!bad)
+        printf("OK\n");
+    return bad;
+}
+#endif
+
+#ifdef CRC32_CTX
+/*
+ * Log appender pattern: 1..7 byte appends with an occasional large record.
+ * Compares crc32_hw per append against crc32c_ctx.
+ */
+static int bench_ctx(void)
+{
+    const size_t size = 1024 * 1024;
+    const int loops = 100;
+    uint8_t *in = malloc(size);
+    size_t *frag = malloc(size * sizeof(size_t));
+    struct crc32c_ctx ctx;
+    struct timeval tv;
+    uint64_t seed = 0x2019;
+    size_t nfrag = 0;
+    int bad = 0;
+
+    for (size_t i = 0; i < size; ++i)
+        in[i] = i+1;
+
+    for (size_t off = 0; off < size; off += frag[nfrag++]) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        size_t n = (seed >> 59) ? 1 + (seed >> 32) % 7 : 4096 + (seed >> 32) % 4096;
+        frag[nfrag] = n < size - off ? n : size - off;
+    }
+
+    const uint32_t ref = crc32_hw(in, size, 0);
+    uint32_t c1 = 0, c2 = 0;
+    double time;
+
+    gettimeofday(&tv, 0);
+    for (int i = 0; i < loops; ++i) {
+        const uint8_t *p = in;
+        c1 = 0;
+        for (size_t f = 0; f < nfrag; p += frag[f++])
+            c1 = crc32_hw(p, frag[f], c1);
+    }
+    time = elapsed(&tv);
+    printf("%zu appends, %.1f bytes average\n", nfrag, (double)size / nfrag);
+    printf("crc32_hw:   %.2f MB/s\n", (double)size * loops / (1024*1024) / time);
+
+    gettimeofday(&tv, 0);
+    for (int i = 0; i < loops; ++i) {
+        const uint8_t *p = in;
+        crc32c_init(&ctx, 0);
+        for (size_t f = 0; f < nfrag; p += frag[f++])
+            crc32c_update(&ctx, p, frag[f]);
+        c2 = crc32c_final(&ctx);
+    }
+    time = elapsed(&tv);
+    printf("crc32c_ctx: %.2f MB/s\n", (double)size * loops / (1024*1024) / time);
+
+    if (c1 != ref || c2 != ref) {
+        printf("BAD: %x %x, should be %x\n", c1, c2, ref);
+        bad = 1;
+    }
+
+    free(frag);
+    free(in);
+
+    if (!bad)
+        printf("OK\n");
+    return bad;
+}
+#endif
+
+#ifdef CRC32_ASM
+/*
+ * Splits a buffer into random chunks and feeds them out of order: MTU
+ * sized chunks reordered within a 64 chunk window, and 1..64K chunks in
+ * fully shuffled order. Compares against one crc32_hw pass.
+ */
+static int bench_asm(void)
+{
+    const size_t size = 16 * 1024 * 1024;
+    const int loops = 10;
+    const uint32_t init = 0x2019;
+    uint8_t *in = malloc(size);
+    uint64_t *off = malloc(size / 8 * sizeof(uint64_t));
+    uint64_t seed = 0x5eed;
+    struct crc32c_asm a;
+    struct timeval tv;
+    double t_hw = 0, t_asm = 0;
+    uint32_t ref = 0;
+    int bad = 0;
+
+    for (size_t i = 0; i < size; ++i)
+        in[i] = i+1;
+
+    /* nothing to wait for */
+    if (crc32c_asm_init(&a, 0, init)) {
+        printf("alloc failed\n");
+        return 1;
+    }
+    if (!crc32c_asm_done(&a) || crc32c_asm_final(&a) != init ||
+        crc32c_asm_add(&a, 0, in, 0) != CRC32C_ASM_DONE) {
+        printf("BAD: empty buffer not complete\n");
+        bad = 1;
+    }
+    crc32c_asm_free(&a);
+
+    for (int l = 0; l < loops && !bad; ++l) {
+        size_t n = 0;
+        const size_t max = l & 1 ? 64 * 1024 : 1500;
+        const size_t win = l & 1 ? SIZE_MAX : 64;
+
+        for (size_t o = 0; o < size; n++) {
+            off[n] = o;
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            o += 1 + (seed >> 33) % max;
+        }
+        off[n] = size;
+
+        /* shuffle chunk indexes within each window */
+        uint32_t *idx = malloc(n * sizeof(uint32_t));
+        for (size_t i = 0; i < n; ++i)
+            idx[i] = i;
+        for (size_t i = n - 1; i > 0; --i) {
+            const size_t w = i % win;
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            const size_t j = i - (seed >> 33) % (w + 1);
+            const uint32_t t = idx[i]; idx[i] = idx[j]; idx[j] = t;
+        }
+
+        gettimeofday(&tv, 0);
+        ref = crc32_hw(in, size, init);
+        t_hw += elapsed(&tv);
+
+        gettimeofday(&tv, 0);
+        if (crc32c_asm_init(&a, size, init)) {
+            printf("alloc failed\n");
+            free(idx);
+            bad = 1;
+            break;
+        }
+        int ret = CRC32C_ASM_OK;
+        for (size_t i = 0; i < n; ++i) {
+            const uint64_t o = off[idx[i]];
+            ret = crc32c_asm_add(&a, o, in + o, off[idx[i]+1] - o);
+            if (ret < 0 || (ret == CRC32C_ASM_DONE && i != n - 1)) {
+                printf("BAD add: chunk %zu ret %d\n", i, ret);
+                bad = 1;
+                break;
+            }
+        }
+        const uint32_t crc = crc32c_asm_final(&a);
+        t_asm += elapsed(&tv);
+
+        if (!bad && (ret != CRC32C_ASM_DONE || crc != ref)) {
+            printf("BAD: %x, should be %x\n", crc, ref);
+            bad = 1;
+        }
+        if (!bad && crc32c_asm_add(&a, off[n/2], in, 1) != CRC32C_ASM_BAD) {
+            printf("BAD: overlap accepted\n");
+            bad = 1;
+        }
+        if (l < 2)
+            printf("%zu chunks of 1..%zu bytes, window %s\n", n, max,
+                   l & 1 ? "all" : "64");
+
+        crc32c_asm_free(&a);
+        free(idx);
+    }
+
+    printf("crc32_hw:   %.2f MB/s\n", (double)size * loops / (1024*1024) / t_hw);
+    printf("crc32c_asm: %.2f MB/s\n", (double)size * loops / (1024*1024) / t_asm);
+
+    free(off);
+    free(in);
+
+    if (!bad)
+        printf("OK\n");
+    return bad;
+}
+#endif
+
 int main(int argc, const char *argv[])
 {
+#ifdef CRC32_ASM
+    return bench_asm();
+#endif
+#ifdef CRC32_CTX
+    return bench_ctx();
+#endif
+#ifdef CRC32_DUAL
+    return bench_dual();
+#endif
+#ifdef CRC64
+    return bench_crc64();
+#endif
+#ifdef CRC32_PSHUFB
+    return bench_pshufb();
+#endif
+#ifdef CRC32_COMPACT
+    return bench_compact();
+#endif
+#ifdef CRC32_FIXED
+    return bench_fixed();
+#endif
+#ifdef CRC32_LATENCY
+    return bench_latency();
+#endif
+#ifdef CRC32_PREFETCH
+    return bench_prefetch(argc, argv);
+#endif
+
     const size_t size = 1024 * 1024 + 3;
     int loops = 20190;
     uint8_t in[size];
     uint32_t c1 = 0, c2 = 0;
     int check = 0;
-    struct timeval tv1, tv2;
+    struct timeval tv;
 
     if (argc > 1) {
         check = 1;
@@ -339,7 +2149,7 @@ int main(int argc, const char *argv[])
         printf("%x\n", c1);
     }
 
-    gettimeofday(&tv1, 0);
+    gettimeofday(&tv, 0);
     for (int i = 0; i < loops; ++i)
 #if defined(CRC32_ZLIB)
         c2 = crc32(c2, in, size);
@@ -348,10 +2158,8 @@ int main(int argc, const char *argv[])
 #else
         c2 = crc32_hw(in, size, c2);
 #endif
-    gettimeofday(&tv2, 0);
 
-    double time = tv2.tv_usec - tv1.tv_usec;
-    time = time / 1000000 + tv2.tv_sec - tv1.tv_sec;
+    const double time = elapsed(&tv);
     double data = ((double)size * loops) / (1024*1024);
 
 #ifdef CRC32_ZLIB
@@ -366,7 +2174,31 @@ int main(int argc, const char *argv[])
             printf("OK\n");
         else
             printf("BAD: %x\n", c2);
+
+        static const uint8_t zero[4096];
+        for (int n = 0; n <= sizeof(zero); ++n) {
+            if (crc32c_zeros(c2, n) != crc32_hw(zero, n, c2)) {
+                printf("BAD zeros: %d\n", n);
+                break;
+            }
+        }
+
+        const uint8_t *in3[3] = { in + 1, in + 100, in + 2019 };
+        size_t size3[3] = { 1000, 4099, 333 };
+        uint32_t crc3[3] = { 1, 2, 3 };
+        crc32_hw_x3(in3, size3, crc3);
+        for (int i = 0; i < 3; ++i) {
+            if (crc3[i] != crc32_hw(in3[i], size3[i], i + 1))
+                printf("BAD x3: %d\n", i);
+        }
     }
 
+#ifdef CRC32_TELEMETRY
+    struct crc32_telemetry tm;
+    crc32_telemetry_snapshot(&tm);
+    crc32_telemetry_print(stdout, &tm);
+#endif
+
     return 0;
 }
+#endif  /* CRC32_LIB */
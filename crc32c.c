@@ -0,0 +1,883 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#define CRC32_LIB
+#include "crc.c"
+
+/*
+ * crc32c [-d] [FILE]...
+ * crc32c [-j N] -c MANIFEST
+ *
+ * Print CRC-32C (init and final xor 0xFFFFFFFF) of each file, or of stdin.
+ * Holes in sparse files are found with SEEK_DATA/SEEK_HOLE and never read,
+ * their zeros are added to the CRC with crc32c_zeros in O(log n).
+ *
+ * -c verifies "crc32  name" lines as printed above on a work-stealing pool
+ * of N threads (default: online cpus):
+ * - manifest entries are queued in batches, round robin over the workers
+ * - large files are split into chunks pushed to the owner's deque, idle
+ *   workers steal them, chunk CRCs are stitched with crc32c_zeros
+ * - small files of a batch are hashed three at a time by crc32_hw_x3
+ * - a batch keeps the next LOOKAHEAD files open with readahead requested,
+ *   so reads of later files overlap hashing of earlier ones
+ *
+ * -d bypasses the page cache for cold storage scrubs: O_DIRECT reads into
+ * a pool of hugepage backed buffers, URING_QD reads in flight on io_uring.
+ * Completed buffers are hashed at once and recycled, their CRCs combined in
+ * offset order with crc32c_zeros as earlier chunks complete. Unlike the
+ * default path, -d reads through holes of sparse files (the filesystem
+ * returns zeros) instead of skipping them with SEEK_DATA.
+ */
+
+static const size_t buf_size = 1024 * 1024;
+
+#define CHUNK_SIZE  (8 * 1024 * 1024)   /* larger files are split */
+#define SMALL_SIZE  (256 * 1024)        /* hashed three at a time */
+#define BATCH       32                  /* manifest entries per task */
+#define LOOKAHEAD   4                   /* files of a batch opened ahead */
+#define OPEN_RETRY  1000                /* 1 ms waits on EMFILE */
+
+/* CRC of file range [off, end), -1 on read error */
+static int crc_range(int fd, off_t off, off_t end, uint32_t *crc, uint8_t *buf)
+{
+    while (off < end) {
+        off_t data = lseek(fd, off, SEEK_DATA);
+        if (data < 0)
+            data = (errno == ENXIO) ? end : off;    /* ENXIO: hole till EOF */
+        if (data > end)
+            data = end;
+        *crc = crc32c_zeros(*crc, data - off);
+        off = data;
+        if (off == end)
+            break;
+
+        off_t hole = lseek(fd, off, SEEK_HOLE);
+        if (hole < 0 || hole > end)
+            hole = end;
+
+        while (off < hole) {
+            size_t len = hole - off < buf_size ? hole - off : buf_size;
+            ssize_t n = pread(fd, buf, len, off);
+            if (n <= 0)
+                return -1;
+            *crc = crc32_hw(buf, n, *crc);
+            off += n;
+        }
+    }
+
+    return 0;
+}
+
+static int crc_stream(int fd, uint32_t *crc, uint8_t *buf)
+{
+    ssize_t n;
+
+    while ((n = read(fd, buf, buf_size)) > 0)
+        *crc = crc32_hw(buf, n, *crc);
+
+    return n < 0 ? -1 : 0;
+}
+
+static int crc_file(const char *name, uint32_t *crc, uint8_t *buf)
+{
+    struct stat st;
+    int fd, ret;
+
+    *crc = ~0U;
+
+    if (!name)
+        return crc_stream(0, crc, buf);
+
+    fd = open(name, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+        ret = crc_range(fd, 0, st.st_size, crc, buf);
+    else
+        ret = crc_stream(fd, crc, buf);
+
+    close(fd);
+    return ret;
+}
+
+#define URING_QD        32
+#define URING_BLOCK     (1024 * 1024)
+#define URING_RETRY     8               /* failed enters before giving up */
+
+/* bare io_uring, one ring per process, no liburing */
+struct uring {
+    int fd;
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    unsigned to_submit;
+};
+
+static int uring_init(struct uring *r, unsigned entries)
+{
+    struct io_uring_params p;
+    void *sq, *cq;
+
+    memset(&p, 0, sizeof(p));
+    r->fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (r->fd < 0)
+        return -1;
+
+    size_t sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        sq_len = cq_len = sq_len > cq_len ? sq_len : cq_len;
+
+    sq = mmap(NULL, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+              r->fd, IORING_OFF_SQ_RING);
+    cq = (p.features & IORING_FEAT_SINGLE_MMAP) ? sq :
+         mmap(NULL, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+              r->fd, IORING_OFF_CQ_RING);
+    r->sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe),
+                   PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   r->fd, IORING_OFF_SQES);
+    if (sq == MAP_FAILED || cq == MAP_FAILED || r->sqes == MAP_FAILED) {
+        close(r->fd);
+        return -1;
+    }
+
+    r->sq_tail = (unsigned *)((char *)sq + p.sq_off.tail);
+    r->sq_mask = (unsigned *)((char *)sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)((char *)sq + p.sq_off.array);
+    r->cq_head = (unsigned *)((char *)cq + p.cq_off.head);
+    r->cq_tail = (unsigned *)((char *)cq + p.cq_off.tail);
+    r->cq_mask = (unsigned *)((char *)cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)((char *)cq + p.cq_off.cqes);
+    r->to_submit = 0;
+
+    return 0;
+}
+
+static void uring_read(struct uring *r, int fd, void *buf, unsigned len,
+                       off_t off, uint64_t user_data)
+{
+    const unsigned tail = *r->sq_tail;
+    const unsigned idx = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t)buf;
+    sqe->len = len;
+    sqe->off = off;
+    sqe->user_data = user_data;
+    r->sq_array[idx] = idx;
+
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    r->to_submit++;
+}
+
+static int uring_enter(struct uring *r, unsigned min_complete)
+{
+    int ret;
+
+    do {
+        ret = syscall(__NR_io_uring_enter, r->fd, r->to_submit, min_complete,
+                      min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret >= 0)
+        r->to_submit -= ret < r->to_submit ? ret : r->to_submit;
+    return ret < 0 ? -1 : 0;
+}
+
+/* hugepages if reserved, else transparent hugepages hint */
+static void *alloc_huge(size_t len)
+{
+    void *p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+    if (p == MAP_FAILED) {
+        p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            return NULL;
+        madvise(p, len, MADV_HUGEPAGE);
+    }
+
+    return p;
+}
+
+struct direct {
+    struct uring ring;
+    uint8_t *pool;
+    int have_ring;
+};
+
+/*
+ * Ring broken with reads still in flight: the kernel may yet write into the
+ * pool, so unmap it and give later files a fresh one. munmap is safe here,
+ * O_DIRECT pins the target pages until each read completes, and they are
+ * only freed after that. Nothing we map later can alias them.
+ */
+static void direct_abandon(struct direct *d)
+{
+    close(d->ring.fd);
+    munmap(d->pool, (size_t)URING_QD * URING_BLOCK);
+    d->pool = alloc_huge((size_t)URING_QD * URING_BLOCK);
+}
+
+/*
+ * Chunk k covers [k*URING_BLOCK, (k+1)*URING_BLOCK). At most URING_QD chunks
+ * past the oldest uncombined one are issued, so per chunk state fits in
+ * slots indexed by k % URING_QD.
+ */
+static int crc_direct(struct direct *d, int fd, off_t size, uint32_t *crc)
+{
+    const uint64_t nchunks = (size + URING_BLOCK - 1) / URING_BLOCK;
+    uint32_t slot_crc[URING_QD];
+    int slot_done[URING_QD] = { 0 };
+    int free_buf[URING_QD], nfree = 0;
+    uint64_t issued = 0, done = 0;
+    int inflight = 0, err = 0, fails = 0;
+
+    for (int b = URING_QD - 1; b >= 0; --b)
+        free_buf[nfree++] = b;
+
+    /* on error stop issuing, but reap what is in flight before returning */
+    while (inflight || (!err && done < nchunks)) {
+        while (!err && nfree && issued < nchunks && issued < done + URING_QD) {
+            const int b = free_buf[--nfree];
+            /* user_data: buffer << 48 | chunk */
+            uring_read(&d->ring, fd, d->pool + (size_t)b * URING_BLOCK,
+                       URING_BLOCK, issued * URING_BLOCK, (uint64_t)b << 48 | issued);
+            issued++;
+            inflight++;
+        }
+        if (uring_enter(&d->ring, 1)) {
+            /* later files use pread, this one still reaps its reads */
+            if (!err)
+                err = errno;
+            d->have_ring = 0;
+            if (++fails == URING_RETRY) {
+                direct_abandon(d);
+                break;
+            }
+        } else {
+            fails = 0;
+        }
+
+        unsigned head = *d->ring.cq_head;
+        const unsigned tail = __atomic_load_n(d->ring.cq_tail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail; ++head) {
+            const struct io_uring_cqe *cqe = &d->ring.cqes[head & *d->ring.cq_mask];
+            const int b = cqe->user_data >> 48;
+            const uint64_t k = cqe->user_data & ((1ULL << 48) - 1);
+            const off_t len = size - (off_t)k * URING_BLOCK < URING_BLOCK ?
+                              size - (off_t)k * URING_BLOCK : URING_BLOCK;
+
+            inflight--;
+            free_buf[nfree++] = b;
+            if (err)
+                continue;
+            if (cqe->res != len) {
+                err = cqe->res < 0 ? -cqe->res : EIO;
+                continue;
+            }
+
+            slot_crc[k % URING_QD] = crc32_hw(d->pool + (size_t)b * URING_BLOCK,
+                                              len, k ? 0 : ~0U);
+            slot_done[k % URING_QD] = 1;
+        }
+        __atomic_store_n(d->ring.cq_head, head, __ATOMIC_RELEASE);
+
+        /* CRC(A|B) = A * x^(8*|B|) ^ B, in offset order */
+        while (!err && done < nchunks && slot_done[done % URING_QD]) {
+            const off_t len = size - (off_t)done * URING_BLOCK < URING_BLOCK ?
+                              size - (off_t)done * URING_BLOCK : URING_BLOCK;
+            *crc = done ? crc32c_zeros(*crc, len) ^ slot_crc[done % URING_QD] :
+                          slot_crc[0];
+            slot_done[done % URING_QD] = 0;
+            done++;
+        }
+    }
+
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+/* O_DIRECT pread fallback when io_uring is not available */
+static int crc_direct_sync(struct direct *d, int fd, off_t size, uint32_t *crc)
+{
+    for (off_t off = 0; off < size; off += URING_BLOCK) {
+        const off_t len = size - off < URING_BLOCK ? size - off : URING_BLOCK;
+        if (pread(fd, d->pool, URING_BLOCK, off) != len)
+            return -1;
+        *crc = crc32_hw(d->pool, len, *crc);
+    }
+
+    return 0;
+}
+
+static int crc_file_direct(struct direct *d, const char *name, uint32_t *crc,
+                           uint8_t *buf)
+{
+    struct stat st;
+    int fd, ret;
+
+    if (!d->pool)                           /* lost to direct_abandon */
+        return crc_file(name, crc, buf);
+
+    fd = open(name, O_RDONLY | O_DIRECT);
+    if (fd < 0 && errno == EINVAL)          /* no O_DIRECT on this fs */
+        return crc_file(name, crc, buf);
+    if (fd < 0)
+        return -1;
+
+    *crc = ~0U;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return crc_file(name, crc, buf);
+    }
+
+    if (d->have_ring)
+        ret = crc_direct(d, fd, st.st_size, crc);
+    else
+        ret = crc_direct_sync(d, fd, st.st_size, crc);
+
+    close(fd);
+    return ret;
+}
+
+enum { ENTRY_OK, ENTRY_MISMATCH, ENTRY_ERROR };
+
+struct entry {
+    char *name;
+    uint32_t expect;
+    off_t size;
+    uint32_t *chunk;        /* chunk CRCs of a split file */
+    atomic_int left;        /* chunks not done yet */
+    atomic_int error;
+    int status;
+};
+
+enum { TASK_BATCH, TASK_CHUNK };
+
+struct task {
+    int type;
+    size_t entry;           /* first entry of batch, or split file */
+    size_t n;               /* entries in batch, or chunk index */
+};
+
+/* owner pushes and pops at tail, thieves steal from head */
+struct deque {
+    pthread_mutex_t lock;
+    struct task *t;
+    size_t head, tail, cap;
+};
+
+struct pool {
+    struct entry *e;
+    struct deque *q;
+    int nworkers;
+    atomic_long pending;    /* tasks queued or running */
+    pthread_mutex_t lock;   /* idle workers sleep on wake */
+    pthread_cond_t wake;
+    unsigned long gen;      /* bumped on push, and when pending drops to 0 */
+};
+
+struct worker {
+    struct pool *pool;
+    int id;
+    uint8_t *buf;
+    uint8_t *small[3];
+};
+
+static void deque_push(struct deque *q, struct task t)
+{
+    pthread_mutex_lock(&q->lock);
+    if (q->tail == q->cap) {
+        memmove(q->t, q->t + q->head, (q->tail - q->head) * sizeof(*q->t));
+        q->tail -= q->head;
+        q->head = 0;
+        if (q->tail == q->cap) {
+            q->cap = q->cap ? q->cap * 2 : 64;
+            q->t = realloc(q->t, q->cap * sizeof(*q->t));
+        }
+    }
+    q->t[q->tail++] = t;
+    pthread_mutex_unlock(&q->lock);
+}
+
+static int deque_pop(struct deque *q, struct task *t)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&q->lock);
+    if (q->head < q->tail) {
+        *t = q->t[--q->tail];
+        ret = 1;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+static int deque_steal(struct deque *q, struct task *t)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&q->lock);
+    if (q->head < q->tail) {
+        *t = q->t[q->head++];
+        ret = 1;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+static void pool_wake(struct pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->gen++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void pool_push(struct pool *pool, int id, struct task t)
+{
+    deque_push(&pool->q[id], t);
+    pool_wake(pool);
+}
+
+static void entry_done(struct entry *e, uint32_t crc)
+{
+    if (atomic_load(&e->error))
+        e->status = ENTRY_ERROR;
+    else
+        e->status = (~crc == e->expect) ? ENTRY_OK : ENTRY_MISMATCH;
+}
+
+/* stitch chunks when the last one is done: CRC(A|B) = A * x^(8*|B|) ^ B */
+static void chunk_done(struct entry *e, size_t k, uint32_t crc)
+{
+    e->chunk[k] = crc;
+    if (atomic_fetch_sub(&e->left, 1) != 1)
+        return;
+
+    const size_t nchunks = (e->size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    crc = e->chunk[0];
+    for (size_t i = 1; i < nchunks; ++i) {
+        off_t len = e->size - (off_t)i * CHUNK_SIZE;
+        if (len > CHUNK_SIZE)
+            len = CHUNK_SIZE;
+        crc = crc32c_zeros(crc, len) ^ e->chunk[i];
+    }
+    free(e->chunk);
+    entry_done(e, crc);
+}
+
+/* open, waiting for other workers to give back descriptors on EMFILE */
+static int open_retry(const char *name)
+{
+    for (int i = 0; ; ++i) {
+        const int fd = open(name, O_RDONLY);
+
+        if (fd >= 0 || errno != EMFILE || i == OPEN_RETRY)
+            return fd;
+        usleep(1000);
+    }
+}
+
+/* open and stat a batch entry, readahead if it is hashed in one go */
+static int batch_open(struct entry *e, int retry)
+{
+    struct stat st;
+    const int fd = retry ? open_retry(e->name) : open(e->name, O_RDONLY);
+
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &st)) {
+        close(fd);
+        return -1;
+    }
+    e->size = st.st_size;
+    if (e->size <= CHUNK_SIZE)
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    return fd;
+}
+
+static void run_chunk(struct worker *w, struct entry *e, size_t k, int fd)
+{
+    const off_t off = (off_t)k * CHUNK_SIZE;
+    const off_t end = off + CHUNK_SIZE < e->size ? off + CHUNK_SIZE : e->size;
+    uint32_t crc = k ? 0 : ~0U;
+    int own = fd < 0;
+
+    if (own)
+        fd = open_retry(e->name);
+    if (fd < 0 || crc_range(fd, off, end, &crc, w->buf))
+        atomic_store(&e->error, 1);
+    if (own && fd >= 0)
+        close(fd);
+
+    chunk_done(e, k, crc);
+}
+
+static void flush_small(struct worker *w, struct entry **se, size_t *ss, int n)
+{
+    uint32_t crc[3] = { ~0U, ~0U, ~0U };
+
+    if (n == 3) {
+        crc32_hw_x3((const uint8_t *const *)w->small, ss, crc);
+    } else {
+        for (int i = 0; i < n; ++i)
+            crc[i] = crc32_hw(w->small[i], ss[i], crc[i]);
+    }
+
+    for (int i = 0; i < n; ++i)
+        entry_done(se[i], crc[i]);
+}
+
+static void run_batch(struct worker *w, size_t first, size_t n)
+{
+    struct pool *pool = w->pool;
+    int fd[BATCH];
+    struct entry *se[3];
+    size_t ss[3];
+    int ns = 0;
+    size_t ahead = 0;
+
+    for (size_t i = 0; i < n; ++i) {
+        struct entry *e = &pool->e[first + i];
+
+        /* readahead of the next files runs while this one is hashed */
+        for (; ahead < n && ahead < i + LOOKAHEAD; ++ahead)
+            fd[ahead] = batch_open(&pool->e[first + ahead], 0);
+
+        /* lookahead open failed, maybe EMFILE: give back the rest, retry */
+        if (fd[i] < 0) {
+            for (size_t j = i + 1; j < ahead; ++j) {
+                if (fd[j] >= 0)
+                    close(fd[j]);
+                fd[j] = -1;
+            }
+            fd[i] = batch_open(e, 1);
+        }
+        if (fd[i] < 0) {
+            e->status = ENTRY_ERROR;
+            continue;
+        }
+
+        if (e->size > CHUNK_SIZE) {
+            const size_t nchunks = (e->size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+            e->chunk = malloc(nchunks * sizeof(uint32_t));
+            atomic_store(&e->left, nchunks);
+            atomic_fetch_add(&pool->pending, nchunks - 1);
+            for (size_t k = nchunks - 1; k > 0; --k)
+                pool_push(pool, w->id, (struct task){ TASK_CHUNK, first + i, k });
+            run_chunk(w, e, 0, fd[i]);
+        } else if (e->size <= SMALL_SIZE) {
+            size_t len = 0;
+            ssize_t r;
+
+            while (len < e->size &&
+                   (r = pread(fd[i], w->small[ns] + len, e->size - len, len)) > 0)
+                len += r;
+            if (len != e->size) {
+                e->status = ENTRY_ERROR;
+                goto next;
+            }
+            se[ns] = e;
+            ss[ns] = len;
+            if (++ns == 3) {
+                flush_small(w, se, ss, ns);
+                ns = 0;
+            }
+        } else {
+            uint32_t crc = ~0U;
+
+            if (crc_range(fd[i], 0, e->size, &crc, w->buf))
+                e->status = ENTRY_ERROR;
+            else
+                entry_done(e, crc);
+        }
+next:
+        close(fd[i]);
+    }
+
+    flush_small(w, se, ss, ns);
+}
+
+static void *worker(void *arg)
+{
+    struct worker *w = arg;
+    struct pool *pool = w->pool;
+    struct task t;
+
+    for (;;) {
+        /* pushes after this snapshot change gen, so none is slept through */
+        pthread_mutex_lock(&pool->lock);
+        const unsigned long gen = pool->gen;
+        pthread_mutex_unlock(&pool->lock);
+
+        int found = deque_pop(&pool->q[w->id], &t);
+
+        for (int i = 1; !found && i < pool->nworkers; ++i)
+            found = deque_steal(&pool->q[(w->id + i) % pool->nworkers], &t);
+
+        if (!found) {
+            /* running tasks may still spawn chunks */
+            pthread_mutex_lock(&pool->lock);
+            while (pool->gen == gen && atomic_load(&pool->pending))
+                pthread_cond_wait(&pool->wake, &pool->lock);
+            pthread_mutex_unlock(&pool->lock);
+
+            if (atomic_load(&pool->pending) == 0)
+                break;
+            continue;
+        }
+
+        if (t.type == TASK_BATCH)
+            run_batch(w, t.entry, t.n);
+        else
+            run_chunk(w, &pool->e[t.entry], t.n, -1);
+
+        if (atomic_fetch_sub(&pool->pending, 1) == 1)
+            pool_wake(pool);
+    }
+
+    return NULL;
+}
+
+/* "crc32  name" lines, returns number of entries, -1 on error */
+static long read_manifest(const char *name, struct entry **entries)
+{
+    FILE *f = strcmp(name, "-") ? fopen(name, "r") : stdin;
+    struct entry *e = NULL;
+    size_t n = 0, cap = 0, len = 0;
+    char *line = NULL;
+    ssize_t r;
+    long lineno = 0;
+
+    if (!f)
+        return -1;
+
+    while ((r = getline(&line, &len, f)) > 0) {
+        char *end;
+
+        ++lineno;
+        if (line[r-1] == '\n')
+            line[--r] = 0;
+
+        unsigned long crc = strtoul(line, &end, 16);
+        if (end != line + 8 || *end != ' ') {
+            fprintf(stderr, "%s: %ld: improperly formatted line\n", name, lineno);
+            continue;
+        }
+        while (*end == ' ')
+            ++end;
+
+        if (n == cap) {
+            cap = cap ? cap * 2 : 1024;
+            e = realloc(e, cap * sizeof(*e));
+        }
+        memset(&e[n], 0, sizeof(*e));
+        e[n].name = strdup(end);
+        e[n].expect = crc;
+        ++n;
+    }
+
+    free(line);
+    if (f != stdin)
+        fclose(f);
+
+    *entries = e;
+    return n;
+}
+
+static int check(const char *manifest, int nworkers)
+{
+    struct pool pool = { .nworkers = nworkers };
+    pthread_t tid[nworkers];
+    struct worker w[nworkers];
+    long n = read_manifest(manifest, &pool.e);
+    long mismatch = 0, error = 0;
+    int nomem = 0;
+
+    if (n < 0) {
+        fprintf(stderr, "%s: %s\n", manifest, strerror(errno));
+        return 1;
+    }
+
+    /* all buffers first, no thread may be left running over pool on failure */
+    memset(w, 0, sizeof(w));
+    for (int i = 0; i < nworkers && !nomem; ++i) {
+        nomem = posix_memalign((void **)&w[i].buf, 4096, buf_size);
+        for (int k = 0; k < 3 && !nomem; ++k)
+            nomem = posix_memalign((void **)&w[i].small[k], 4096, SMALL_SIZE);
+    }
+    if (nomem) {
+        fprintf(stderr, "alloc failed\n");
+        for (int i = 0; i < nworkers; ++i) {
+            free(w[i].buf);
+            for (int k = 0; k < 3; ++k)
+                free(w[i].small[k]);
+        }
+        for (long i = 0; i < n; ++i)
+            free(pool.e[i].name);
+        free(pool.e);
+        return 1;
+    }
+
+    pool.q = calloc(nworkers, sizeof(*pool.q));
+    for (int i = 0; i < nworkers; ++i)
+        pthread_mutex_init(&pool.q[i].lock, NULL);
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.wake, NULL);
+
+    for (long first = 0, i = 0; first < n; first += BATCH, ++i) {
+        size_t len = n - first < BATCH ? n - first : BATCH;
+        deque_push(&pool.q[i % nworkers], (struct task){ TASK_BATCH, first, len });
+        atomic_fetch_add(&pool.pending, 1);
+    }
+
+    /* queues of workers that fail to start are drained by stealing */
+    int started = 0;
+    for (int i = 0; i < nworkers; ++i) {
+        w[i].pool = &pool;
+        w[i].id = i;
+    }
+    while (started < nworkers &&
+           pthread_create(&tid[started], NULL, worker, &w[started]) == 0)
+        ++started;
+    if (started < nworkers)
+        fprintf(stderr, "started %d of %d workers\n", started, nworkers);
+    if (started == 0)
+        worker(&w[0]);
+
+    for (int i = 0; i < started; ++i)
+        pthread_join(tid[i], NULL);
+
+    for (int i = 0; i < nworkers; ++i) {
+        free(w[i].buf);
+        for (int k = 0; k < 3; ++k)
+            free(w[i].small[k]);
+        pthread_mutex_destroy(&pool.q[i].lock);
+        free(pool.q[i].t);
+    }
+    free(pool.q);
+    pthread_mutex_destroy(&pool.lock);
+    pthread_cond_destroy(&pool.wake);
+
+    for (long i = 0; i < n; ++i) {
+        struct entry *e = &pool.e[i];
+
+        if (e->status == ENTRY_OK) {
+            printf("%s: OK\n", e->name);
+        } else if (e->status == ENTRY_MISMATCH) {
+            printf("%s: FAILED\n", e->name);
+            ++mismatch;
+        } else {
+            printf("%s: FAILED open or read\n", e->name);
+            ++error;
+        }
+        free(e->name);
+    }
+    free(pool.e);
+
+    if (error)
+        fprintf(stderr, "WARNING: %ld listed files could not be read\n", error);
+    if (mismatch)
+        fprintf(stderr, "WARNING: %ld computed checksums did NOT match\n", mismatch);
+
+    return mismatch || error;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *manifest = NULL;
+    int nworkers = sysconf(_SC_NPROCESSORS_ONLN);
+    uint8_t *buf;
+    uint32_t crc;
+    struct direct d;
+    int ret = 0, opt, direct = 0;
+
+    while ((opt = getopt(argc, argv, "c:dj:")) != -1) {
+        switch (opt) {
+        case 'd':
+            direct = 1;
+            break;
+        case 'c':
+            manifest = optarg;
+            break;
+        case 'j':
+            nworkers = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-d] [FILE]...\n"
+                            "       %s [-j N] -c MANIFEST\n", argv[0], argv[0]);
+            return 1;
+        }
+    }
+
+    if (nworkers < 1)
+        nworkers = 1;
+    if (manifest) {
+        ret = check(manifest, nworkers);
+        goto out;
+    }
+
+    if (posix_memalign((void **)&buf, 4096, buf_size)) {
+        fprintf(stderr, "alloc failed\n");
+        return 1;
+    }
+
+    if (direct) {
+        d.pool = alloc_huge((size_t)URING_QD * URING_BLOCK);
+        if (!d.pool) {
+            fprintf(stderr, "alloc failed\n");
+            return 1;
+        }
+        d.have_ring = uring_init(&d.ring, URING_QD) == 0;
+    }
+
+    if (optind == argc) {
+        if (crc_file(NULL, &crc, buf) == 0)
+            printf("%08x  -\n", ~crc);
+        else
+            ret = 1;
+    }
+
+    for (int i = optind; i < argc; ++i) {
+        if (direct ? crc_file_direct(&d, argv[i], &crc, buf) :
+                     crc_file(argv[i], &crc, buf)) {
+            fprintf(stderr, "%s: %s\n", argv[i], strerror(errno));
+            ret = 1;
+            continue;
+        }
+        printf("%08x  %s\n", ~crc, argv[i]);
+    }
+
+    free(buf);
+out:
+#ifdef CRC32_TELEMETRY
+    {
+        struct crc32_telemetry tm;
+        crc32_telemetry_snapshot(&tm);
+        crc32_telemetry_print(stderr, &tm);
+    }
+#endif
+    return ret;
+}